@@ -0,0 +1,1428 @@
+#include "DiskSampling/PoissonDiskSampling.h"
+#include "DiskSampling/PoissonTileSet.h"
+#include "DiskSampling/TiledPoissonDiskSampling.h"
+#include "MapGenerator/dDelaunay.h"
+#include "MapGenerator/dTriangulator.h"
+#include "MapGenerator/dSpatialSort.h"
+#include "MapGenerator/Structures.h"
+#include "MapGenerator/Map.h"
+#include "MapGenerator/RankSort.h"
+#include "MapGenerator/FrontierPropagation.h"
+#include "MapGenerator/ThreadPool.h"
+#include "MapGenerator/Trace.h"
+#include "MapGenerator/Math/Circumcenter.h"
+#include "MapGenerator/Math/LineEquation.h"
+#include "MapGenerator/Math/PerlinSlice.h"
+#include "noise/noise.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Live heap bytes, to weigh the pointer graph, their peak and number of allocations.
+static size_t g_heap_bytes = 0;
+static size_t g_heap_peak = 0;
+static size_t g_heap_allocations = 0;
+
+void * operator new(size_t size)
+{
+	size_t * block = (size_t *) malloc(size + sizeof(size_t) * 2);
+	if (block == nullptr) throw std::bad_alloc();
+	block[0] = size;
+	g_heap_bytes += size;
+	g_heap_peak = std::max(g_heap_peak, g_heap_bytes);
+	g_heap_allocations++;
+	return block + 2;
+}
+
+void operator delete(void * pointer) noexcept
+{
+	if (pointer == nullptr) return;
+	size_t * block = (size_t *) pointer - 2;
+	g_heap_bytes -= block[0];
+	free(block);
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+// Hardware cache miss counter for the calling thread. Reports -1 when the
+// counter isn't available (not Linux, or perf events are restricted).
+class CacheMissCounter
+{
+public:
+	CacheMissCounter() : m_fd(-1)
+	{
+#ifdef __linux__
+		perf_event_attr attr = perf_event_attr();
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		m_fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if (m_fd >= 0) close(m_fd);
+#endif
+	}
+
+	void Start()
+	{
+#ifdef __linux__
+		if (m_fd < 0) return;
+		ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	long long Stop()
+	{
+		long long count = -1;
+#ifdef __linux__
+		if (m_fd < 0) return -1;
+		ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(m_fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+		return count;
+	}
+
+private:
+	int m_fd;
+};
+
+// Roughly Poisson distributed points: one jittered point per grid cell, in
+// random order like the active list of the sampler produces them.
+std::vector<del::vertex> MakePoints(int count)
+{
+	Random random(count);
+	int side = (int) std::ceil(std::sqrt((double) count));
+	std::vector<del::vertex> points;
+	points.reserve(side * side);
+	for (int i = 0; i < side; i++)
+	{
+		for (int j = 0; j < side; j++)
+		{
+			float x = (i + 0.1f + 0.8f * (float) random.NextDouble()) * 10.0f;
+			float y = (j + 0.1f + 0.8f * (float) random.NextDouble()) * 10.0f;
+			points.push_back(del::vertex(x, y));
+		}
+	}
+	std::shuffle(points.begin(), points.end(), random);
+	points.resize(count);
+	return points;
+}
+
+void BenchTriangulation(const std::vector<del::vertex>& input, const std::string& order_name)
+{
+	std::vector<del::vertex> points(input);
+	if (order_name == "sorted")
+		std::sort(points.begin(), points.end());
+	else if (order_name == "hilbert")
+		del::HilbertSort(points);
+	else if (order_name == "brio")
+		del::BrioSort(points, 1234);
+
+	del::Triangulator triangulator;
+	CacheMissCounter counter;
+
+	counter.Start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	triangulator.Triangulate(points);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	long long misses = counter.Stop();
+
+	printf("%-12s %9zu %-8s %10.2f %14lld\n", "triangulate", points.size(), order_name.c_str(), ms, misses);
+}
+
+// Builds the center/corner/edge graph of a triangulation, finding the edge
+// shared by two centers either with center::GetEdgeWith or by pairing twin
+// half-edges. Returns the build time in ms, not counting the cleanup.
+double BuildGraph(const std::vector<del::vertex>& points, const del::Triangulator& triangulator, bool pair_halfedges,
+	size_t& r_edge_count)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const std::vector<unsigned int>& triangles = triangulator.GetTriangles();
+	const std::vector<unsigned int>& halfedges = triangulator.GetHalfedges();
+
+	std::vector<center *> centers(points.size());
+	for (size_t i = 0; i < points.size(); i++)
+		centers[i] = new center((unsigned int) i, Vec2(points[i].GetX(), points[i].GetY()));
+	std::vector<corner *> corners;
+	std::vector<edge *> edges;
+	std::vector<edge *> halfedge_edges(halfedges.size(), nullptr);
+
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		corner * c = new corner((unsigned int) corners.size(), Vec2());
+		corners.push_back(c);
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			center * from = centers[triangles[t + k]];
+			center * to = centers[triangles[t + (k + 1) % 3]];
+			c->centers.push_back(from);
+			from->corners.push_back(c);
+
+			edge * e = pair_halfedges ? halfedge_edges[t + k] : from->GetEdgeWith(to);
+			if (e == nullptr)
+			{
+				e = new edge((unsigned int) edges.size(), from, to, c, nullptr);
+				edges.push_back(e);
+				from->edges.push_back(e);
+				to->edges.push_back(e);
+				if (pair_halfedges && halfedges[t + k] != del::Triangulator::INVALID_INDEX)
+					halfedge_edges[halfedges[t + k]] = e;
+			}
+			else
+			{
+				e->v1 = c;
+			}
+			c->edges.push_back(e);
+		}
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	r_edge_count = edges.size();
+	for (center * c : centers) delete c;
+	for (corner * c : corners) delete c;
+	for (edge * e : edges) delete e;
+	return ms;
+}
+
+void BenchGraphBuild(const std::vector<del::vertex>& input)
+{
+	std::vector<del::vertex> points(input);
+	del::HilbertSort(points);
+	del::Triangulator triangulator;
+	triangulator.Triangulate(points);
+
+	const char * names[2] = { "scan", "halfedge" };
+	for (int pair_halfedges = 0; pair_halfedges < 2; pair_halfedges++)
+	{
+		size_t edge_count;
+		double ms = BuildGraph(points, triangulator, pair_halfedges != 0, edge_count);
+		printf("%-12s %9zu %-8s %10.2f %10zu\n", "graph", points.size(), names[pair_halfedges], ms, edge_count);
+	}
+}
+
+// Smallest distance between two samples, and largest distance from the
+// centre of a spread sized bucket, away from the borders, to its closest
+// sample: a blue noise set leaves no holes, and keeps it under twice the
+// spread.
+void MeasureSpacing(const std::vector<std::pair<double,double> >& samples, int width, int height, double spread, double& r_min_distance, double& r_max_gap)
+{
+	// Buckets of the spread's size, so only the 3x3 around a sample can be too close.
+	int columns = (int) (width / spread) + 1, rows = (int) (height / spread) + 1;
+	std::vector<std::vector<unsigned int> > buckets((size_t) columns * rows);
+	for (size_t i = 0; i < samples.size(); i++)
+		buckets[(int) (samples[i].second / spread) * columns + (int) (samples[i].first / spread)].push_back((unsigned int) i);
+
+	r_min_distance = spread * 2;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		int x = (int) (samples[i].first / spread), y = (int) (samples[i].second / spread);
+		for (int by = std::max(0, y - 1); by <= std::min(rows - 1, y + 1); by++)
+			for (int bx = std::max(0, x - 1); bx <= std::min(columns - 1, x + 1); bx++)
+				for (unsigned int j : buckets[by * columns + bx])
+					if (j != i)
+						r_min_distance = std::min(r_min_distance, std::hypot(samples[i].first - samples[j].first, samples[i].second - samples[j].second));
+	}
+
+	r_max_gap = 0;
+	for (int y = 2; y < rows - 3; y++)
+		for (int x = 2; x < columns - 3; x++)
+		{
+			double px = (x + 0.5) * spread, py = (y + 0.5) * spread, gap = spread * 3;
+			for (int by = y - 2; by <= y + 2; by++)
+				for (int bx = x - 2; bx <= x + 2; bx++)
+					for (unsigned int j : buckets[by * columns + bx])
+						gap = std::min(gap, std::hypot(px - samples[j].first, py - samples[j].second));
+			r_max_gap = std::max(r_max_gap, gap);
+		}
+}
+
+// Samples an area that gets about sample_count points with the spread the
+// map bench uses, and checks that no two samples are closer than the spread.
+// thread_count 0 runs PoissonDiskSampling, otherwise the tiled sampler.
+void BenchSampling(int sample_count, unsigned int thread_count, const PoissonTileSet * tile_set = nullptr)
+{
+	double spread = 2.0;
+	double scale = std::sqrt(sample_count * 3.1416 * spread * spread / (2.0 * 800 * 600));
+	int width = (int) (800 * scale), height = (int) (600 * scale);
+
+	size_t allocations = g_heap_allocations;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::pair<double,double> > samples;
+	if (tile_set != nullptr)
+	{
+		samples = tile_set->Generate(width, height, spread, Random(sample_count));
+	}
+	else if (thread_count == 0)
+	{
+		PoissonDiskSampling sampler(width, height, spread, 10, Random(sample_count));
+		samples = sampler.Generate();
+	}
+	else
+	{
+		TiledPoissonDiskSampling sampler(width, height, spread, 10, Random(sample_count));
+		sampler.SetThreadCount(thread_count);
+		samples = sampler.Generate();
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	allocations = g_heap_allocations - allocations;
+
+	double min_distance, max_gap;
+	MeasureSpacing(samples, width, height, spread, min_distance, max_gap);
+
+	std::string sampler = tile_set != nullptr ? "tileset" : thread_count == 0 ? "serial" : "tiled/" + std::to_string(thread_count);
+	printf("%-12s %9zu %-10s %10.2f %10zu %12.5f %10.3f\n", "sampling", samples.size(), sampler.c_str(), ms, allocations, min_distance, max_gap);
+}
+
+// Builds the default tile set, and checks that it reads back the same.
+void BenchTileSet(PoissonTileSet& tile_set)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	tile_set.Build(2, 16, 30, Random(1));
+	double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::string file_name = "poisson_tiles.bin";
+	PoissonTileSet loaded;
+	bool saved = tile_set.Save(file_name);
+	bool read = saved && loaded.Load(file_name);
+	bool identical = read && loaded.Generate(1000, 1000, 2.0, Random(7)) == tile_set.Generate(1000, 1000, 2.0, Random(7));
+	std::remove(file_name.c_str());
+
+	printf("%-12s %9d %-10s %10.2f %10s\n", "tileset", tile_set.GetTileCount(), "build", build_ms, identical ? "yes" : "NO");
+}
+
+// Intersection of the perpendicular bisectors of ab and bc, the way corner
+// positions used to be calculated.
+Vec2 BisectorCircumcenter(Vec2 a, Vec2 b, Vec2 c)
+{
+	equ bisectors[2];
+	Vec2 ends[2][2] = { { a, b }, { b, c } };
+	for (int i = 0; i < 2; i++)
+	{
+		Vec2 midpoint((ends[i][0].x + ends[i][1].x) / 2, (ends[i][0].y + ends[i][1].y) / 2);
+		equ side(ends[i][0], ends[i][1]);
+		if (side.Vertical())
+			bisectors[i] = equ(midpoint, Vec2(midpoint.x + 1, midpoint.y));
+		else if (side.Horizontal())
+			bisectors[i] = equ(midpoint, Vec2(midpoint.x, midpoint.y + 1));
+		else
+			bisectors[i] = equ(midpoint, side.m == 0 ? 0 : -1 / side.m);
+	}
+	return bisectors[0].Intersection(bisectors[1]);
+}
+
+// Circumcenters of every triangle with the bisector intersection, the scalar
+// kernel and the batch one, and the largest distance to the batch results.
+void BenchCircumcenters(const std::vector<del::vertex>& input)
+{
+	std::vector<del::vertex> points(input);
+	del::HilbertSort(points);
+	del::Triangulator triangulator;
+	triangulator.Triangulate(points);
+
+	const std::vector<unsigned int>& triangles = triangulator.GetTriangles();
+	size_t count = triangulator.GetTriangleCount();
+	std::vector<double> coords(2 * points.size());
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		coords[2 * i] = points[i].GetX();
+		coords[2 * i + 1] = points[i].GetY();
+	}
+
+	std::vector<double> batch(2 * count), result(2 * count);
+	const char * names[3] = { "bisectors", "scalar", "batch" };
+	for (int method = 2; method >= 0; method--)
+	{
+		std::vector<double>& out = method == 2 ? batch : result;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (method == 2)
+		{
+			Circumcenters(coords.data(), triangles.data(), count, out.data());
+		}
+		else
+		{
+			for (size_t t = 0; t < count; t++)
+			{
+				const double * a = &coords[2 * triangles[3 * t]];
+				const double * b = &coords[2 * triangles[3 * t + 1]];
+				const double * c = &coords[2 * triangles[3 * t + 2]];
+				if (method == 1)
+				{
+					Circumcenter(a[0], a[1], b[0], b[1], c[0], c[1], out[2 * t], out[2 * t + 1]);
+				}
+				else
+				{
+					Vec2 p = BisectorCircumcenter(Vec2(a[0], a[1]), Vec2(b[0], b[1]), Vec2(c[0], c[1]));
+					out[2 * t] = p.x;
+					out[2 * t + 1] = p.y;
+				}
+			}
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		double error = 0;
+		for (size_t t = 0; t < count; t++)
+			error = std::max(error, std::hypot(out[2 * t] - batch[2 * t], out[2 * t + 1] - batch[2 * t + 1]));
+		printf("%-12s %9zu %-10s %10.2f %12.3g\n", "circumcenter", count, names[method], ms, error);
+	}
+}
+
+// The map the benches generate: about cell_count cells at a spread of 2,
+// in the proportions of the example, not generated yet.
+std::unique_ptr<Map> MakeBenchMap(int cell_count, unsigned int threads)
+{
+	double spread = 2.0;
+	double scale = std::sqrt(cell_count * 3.1416 * spread * spread / (2.0 * 800 * 600));
+	std::unique_ptr<Map> map(new Map((int) (800 * scale), (int) (600 * scale), spread, "bench"));
+	map->SetThreadCount(threads);
+	return map;
+}
+
+// Generates a whole map of about cell_count cells with the given sampler.
+// Then compares the size of the graph the stages run on with the pointer
+// nodes exported from it, and counts the heap allocations of the generation
+// and of the export.
+void BenchMap(int cell_count, PointSampler::Type sampler)
+{
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	map->SetPointSampler(sampler);
+
+	size_t allocations = g_heap_allocations;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	map->Generate();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	size_t generate_allocations = g_heap_allocations - allocations;
+
+	size_t before = g_heap_bytes;
+	allocations = g_heap_allocations;
+	std::vector<center *> centers = map->GetCenters();
+	size_t export_allocations = g_heap_allocations - allocations;
+	size_t pointer_bytes = g_heap_bytes - before - centers.capacity() * sizeof(center *);
+
+	double cells = (double) map->GetGraph().center_count;
+	printf("%-12s %9.0f %10.0f %16.1f %16.1f %12zu %12zu\n", sampler == PointSampler::Variable ? "map/variable" : "map", cells, ms,
+		map->GetGraph().GetMemoryUsage() / cells, pointer_bytes / cells, generate_allocations, export_allocations);
+}
+
+// The land noise of a map straight from libnoise, and from its slice one
+// point at a time and in batches, with the largest difference to libnoise.
+void BenchLandNoise(int point_count)
+{
+	noise::module::Perlin perlin;
+	double z = 1234567890;
+	Random random(point_count);
+	std::vector<float> x(point_count), y(point_count), values(point_count);
+	for (int i = 0; i < point_count; i++)
+	{
+		x[i] = (float) (4 * random.NextDouble() - 2);
+		y[i] = (float) (4 * random.NextDouble() - 2);
+	}
+
+	std::vector<double> expected(point_count);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < point_count; i++)
+		expected[i] = perlin.GetValue(x[i], y[i], z);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9d %-8s %10.2f %12s\n", "noise", point_count, "libnoise", ms, "-");
+
+	start = std::chrono::steady_clock::now();
+	PerlinSlice slice;
+	slice.Build(perlin, z, -2, -2, 2, 2);
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9d %-8s %10.2f %12s\n", "noise", point_count, "build", ms, "-");
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < point_count; i++)
+		values[i] = slice.GetValue(x[i], y[i]);
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	double max_error = 0;
+	for (int i = 0; i < point_count; i++)
+		max_error = std::max(max_error, std::abs(values[i] - expected[i]));
+	printf("%-12s %9d %-8s %10.2f %12.2e\n", "noise", point_count, "single", ms, max_error);
+
+	start = std::chrono::steady_clock::now();
+	slice.GetValues(x.data(), y.data(), point_count, values.data());
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	max_error = 0;
+	for (int i = 0; i < point_count; i++)
+		max_error = std::max(max_error, std::abs(values[i] - expected[i]));
+	printf("%-12s %9d %-8s %10.2f %12.2e\n", "noise", point_count, "batch", ms, max_error);
+}
+
+// Square worlds of a fixed spread, so the side grows with the cell count: 10M
+// cells make a world of about 100k units. The peak heap per cell must stay
+// flat, and no two neighbouring cells closer than the spread, which the
+// coordinates rounded to whole units used to break.
+void BenchWorld(int cell_count)
+{
+	double spread = 25.0;
+	int side = (int) std::sqrt(cell_count * 3.1416 * spread * spread / 2.0);
+	size_t start_bytes = g_heap_bytes;
+	g_heap_peak = g_heap_bytes;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Map map(side, side, spread, "world");
+	map.SetThreadCount(1);
+	map.Generate();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	const MapGraph& graph = map.GetGraph();
+	double min_spacing = spread * 2;
+	for (unsigned int c = 0; c < graph.center_count; c++)
+	{
+		if (!graph.IsInsideBoundingBox(graph.center_position[c], side, side)) continue;
+		for (unsigned int i = graph.center_centers_offset[c]; i < graph.center_centers_offset[c + 1]; i++)
+		{
+			const Vec2& a = graph.center_position[c];
+			const Vec2& b = graph.center_position[graph.center_centers[i]];
+			min_spacing = std::min(min_spacing, std::hypot(a.x - b.x, a.y - b.y));
+		}
+	}
+
+	double cells = (double) graph.center_count;
+	printf("%-12s %9.0f %9d %10.0f %12.1f %12.1f %12.4f\n", "world", cells, side, ms, 1000 * ms / cells,
+		(g_heap_peak - start_bytes) / cells, min_spacing / spread);
+}
+
+// The corner distances to the border of a map as the FIFO relaxation used to
+// find them, re-queuing a corner every time it got closer, and with the
+// buckets of the graph, which settle every corner once.
+void BenchCornerElevation(int cell_count)
+{
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	map->Generate();
+	const MapGraph& graph = map->GetGraph();
+	double corners = graph.corner_count;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<double> expected(graph.corner_count, 99999);
+	std::vector<unsigned int> queue;
+	std::vector<unsigned char> queued(graph.corner_count, 0);
+	for (unsigned int q = 0; q < graph.corner_count; q++)
+	{
+		if (graph.corner_flags[q] & MapGraph::Border)
+		{
+			expected[q] = 0.0;
+			queue.push_back(q);
+			queued[q] = 1;
+		}
+	}
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		unsigned int q = queue[head];
+		queued[q] = 0;
+		for (unsigned int i = graph.corner_corners_offset[q]; i < graph.corner_corners_offset[q + 1]; i++)
+		{
+			unsigned int s = graph.corner_corners[i];
+			double elevation = expected[q] + 0.01;
+			if (!(graph.corner_flags[q] & MapGraph::Water) && !(graph.corner_flags[s] & MapGraph::Water))
+				elevation += 1;
+			if (elevation < expected[s])
+			{
+				expected[s] = elevation;
+				if (!queued[s])
+				{
+					queue.push_back(s);
+					queued[s] = 1;
+				}
+			}
+		}
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9.0f %-8s %10.2f %10.2f %10s\n", "elevation", corners, "fifo", ms, queue.size() / corners, "-");
+
+	start = std::chrono::steady_clock::now();
+	std::vector<double> distance;
+	size_t pushes = graph.DistanceToBorder(distance);
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9.0f %-8s %10.2f %10.2f %10s\n", "elevation", corners, "buckets", ms, pushes / corners, distance == expected ? "yes" : "NO");
+}
+
+// Max propagation with a serial FIFO queue, as the moisture stage used to.
+static void PropagateMaxSerial(const MapGraph& graph, const std::vector<unsigned int>& seeds, double factor, std::vector<double>& values)
+{
+	std::vector<unsigned int> queue(seeds);
+	std::vector<unsigned char> queued(graph.corner_count, 0);
+	for (unsigned int seed : seeds)
+		queued[seed] = 1;
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		unsigned int c = queue[head];
+		queued[c] = 0;
+		for (unsigned int i = graph.corner_corners_offset[c]; i < graph.corner_corners_offset[c + 1]; i++)
+		{
+			unsigned int r = graph.corner_corners[i];
+			if (values[c] * factor > values[r])
+			{
+				values[r] = values[c] * factor;
+				if (!queued[r])
+				{
+					queue.push_back(r);
+					queued[r] = 1;
+				}
+			}
+		}
+	}
+}
+
+// The ocean flood fill and the fresh water moisture sweep of a map, with a
+// serial queue and level by level on 1 to 32 threads.
+void BenchPropagation(int cell_count)
+{
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	map->Generate();
+	const MapGraph& graph = map->GetGraph();
+
+	std::vector<unsigned int> ocean_seeds, moisture_seeds;
+	std::vector<unsigned char> water(graph.center_count);
+	for (unsigned int c = 0; c < graph.center_count; c++)
+	{
+		water[c] = graph.center_flags[c] & MapGraph::Water;
+		if (graph.center_flags[c] & MapGraph::Border)
+			ocean_seeds.push_back(c);
+	}
+	std::vector<double> moisture(graph.corner_count, 0.0);
+	for (unsigned int c = 0; c < graph.corner_count; c++)
+	{
+		if ((graph.corner_flags[c] & MapGraph::Water) && !(graph.corner_flags[c] & MapGraph::Ocean))
+		{
+			moisture[c] = 1.0;
+			moisture_seeds.push_back(c);
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<unsigned char> expected_ocean(water);
+	std::vector<unsigned int> queue(ocean_seeds);
+	for (unsigned int seed : ocean_seeds)
+		expected_ocean[seed] |= MapGraph::Ocean;
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		unsigned int c = queue[head];
+		for (unsigned int i = graph.center_centers_offset[c]; i < graph.center_centers_offset[c + 1]; i++)
+		{
+			unsigned int r = graph.center_centers[i];
+			if (expected_ocean[r] == MapGraph::Water)
+			{
+				expected_ocean[r] |= MapGraph::Ocean;
+				queue.push_back(r);
+			}
+		}
+	}
+	double flood_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	std::vector<double> expected_moisture(moisture);
+	PropagateMaxSerial(graph, moisture_seeds, 0.9, expected_moisture);
+	double moisture_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9u %-8s %10.2f %10s %10s\n", "flood", graph.center_count, "serial", flood_ms, "-", "-");
+	printf("%-12s %9u %-8s %10.2f %10s %10s\n", "moisture", graph.corner_count, "serial", moisture_ms, "-", "-");
+
+	const unsigned int thread_counts[] = { 1, 4, 16, 32 };
+	for (unsigned int threads : thread_counts)
+	{
+		ThreadPool pool(threads);
+		FrontierPropagation propagation(pool);
+
+		start = std::chrono::steady_clock::now();
+		std::vector<unsigned char> ocean(water);
+		propagation.Flood(graph.center_centers_offset, graph.center_centers, ocean_seeds, MapGraph::Water, MapGraph::Ocean, ocean);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%-12s %9u %-8u %10.2f %10u %10s\n", "flood", graph.center_count, threads, ms, propagation.GetLevelCount(),
+			ocean == expected_ocean ? "yes" : "NO");
+
+		start = std::chrono::steady_clock::now();
+		std::vector<double> values(moisture);
+		propagation.PropagateMax(graph.corner_corners_offset, graph.corner_corners, moisture_seeds, 0.9, values);
+		ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%-12s %9u %-8u %10.2f %10u %10s\n", "moisture", graph.corner_count, threads, ms, propagation.GetLevelCount(),
+			values == expected_moisture ? "yes" : "NO");
+	}
+}
+
+// Ranking the land corners of a map by moisture, the way the redistribution
+// stages used to with std::sort, and with the radix sort on 1 to 32 threads.
+// The radix sort must give the order of a stable sort.
+void BenchRankSort(int cell_count)
+{
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	map->Generate();
+	const MapGraph& graph = map->GetGraph();
+
+	// The corner distances to the border, as RedistributeElevations sees them.
+	std::vector<double> keys;
+	graph.DistanceToBorder(keys);
+	std::vector<unsigned int> land;
+	for (unsigned int c = 0; c < graph.corner_count; c++)
+	{
+		if (!(graph.corner_flags[c] & MapGraph::Water))
+			land.push_back(c);
+	}
+
+	std::vector<unsigned int> expected(land);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::sort(expected.begin(), expected.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+	double sort_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %9zu %-8s %10.2f %9s %10s\n", "rank", land.size(), "sort", sort_ms, "-", "-");
+
+	expected = land;
+	std::stable_sort(expected.begin(), expected.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+
+	const unsigned int thread_counts[] = { 1, 4, 16, 32 };
+	for (unsigned int threads : thread_counts)
+	{
+		ThreadPool pool(threads);
+		std::vector<unsigned int> indices(land);
+		start = std::chrono::steady_clock::now();
+		RankSort(keys, indices, pool);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%-12s %9zu %-8u %10.2f %8.2fx %10s\n", "rank", land.size(), threads, ms, sort_ms / ms, indices == expected ? "yes" : "NO");
+	}
+}
+
+// FNV-1a of the bytes of a vector, to compare the graphs of two runs.
+template <typename T>
+uint64_t HashVector(const std::vector<T>& values, uint64_t hash = 14695981039346656037ull)
+{
+	const unsigned char * bytes = (const unsigned char *) values.data();
+	for (size_t i = 0; i < values.size() * sizeof(T); i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+uint64_t HashGraph(const MapGraph& graph)
+{
+	uint64_t hash = HashVector(graph.center_corners);
+	hash = HashVector(graph.corner_corners, hash);
+	hash = HashVector(graph.center_flags, hash);
+	hash = HashVector(graph.corner_flags, hash);
+	hash = HashVector(graph.center_elevation, hash);
+	hash = HashVector(graph.corner_elevation, hash);
+	hash = HashVector(graph.corner_downslope_edge, hash);
+	hash = HashVector(graph.center_moisture, hash);
+	return HashVector(graph.center_biome, hash);
+}
+
+// Erosion stage time for 32 iterations, and how much it lowered the land
+// corners, on 1 and 4 threads, which must give the same elevations.
+void BenchErosion(int cell_count)
+{
+	static const unsigned int ITERATIONS = 32;
+
+	std::unique_ptr<Map> plain = MakeBenchMap(cell_count, 1);
+	plain->Generate();
+	const MapGraph& before = plain->GetGraph();
+
+	uint64_t serial_hash = 0;
+	const unsigned int thread_counts[] = { 1, 4 };
+	for (unsigned int threads : thread_counts)
+	{
+		std::unique_ptr<Map> map = MakeBenchMap(cell_count, threads);
+		map->SetErosionIterations(ITERATIONS);
+		map->Generate();
+		const MapGraph& graph = map->GetGraph();
+
+		double ms = 0;
+		for (const std::pair<std::string,double>& time : map->GetStageTimes())
+			if (time.first == "Erosion") ms = time.second;
+
+		double lowered = 0, deepest = 0;
+		unsigned int land = 0;
+		for (unsigned int q = 0; q < graph.corner_count; q++)
+		{
+			if (graph.corner_flags[q] & MapGraph::Water) continue;
+			double drop = before.corner_elevation[q] - graph.corner_elevation[q];
+			lowered += drop;
+			deepest = std::max(deepest, drop);
+			land++;
+		}
+
+		uint64_t hash = HashVector(graph.corner_elevation);
+		if (threads == 1) serial_hash = hash;
+		printf("%-12s %9u %-8u %10.2f %10.2f %10.4f %10.4f %10s\n", "erosion", graph.center_count, threads,
+			ms, ms / ITERATIONS, lowered / std::max(land, 1u), deepest, hash == serial_hash ? "yes" : "NO");
+	}
+}
+
+// Depression filling on a graph generated up to its elevations, before the
+// flood fills them. The corners that are neither ocean nor coast and have no
+// downslope end the rivers inland: with only the lowest neighbours, and after
+// the flood. Outside the lakes the downslopes must stay the lowest
+// neighbours, and they must make a forest.
+void BenchDepressions(int cell_count)
+{
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	map->Generate(MapStage::AltitudeRedistribution);
+	MapGraph graph = map->GetGraph();
+
+	std::vector<unsigned int> lowest(graph.corner_count);
+	unsigned int sinks = 0;
+	for (unsigned int q = 0; q < graph.corner_count; q++)
+	{
+		lowest[q] = MapGraph::INVALID_INDEX;
+		unsigned int d = q;
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int e = graph.corner_edges[3 * q + k];
+			unsigned int s = graph.GetOpositeCorner(e, q);
+			if (s != MapGraph::INVALID_INDEX && graph.corner_elevation[s] < graph.corner_elevation[d])
+			{
+				d = s;
+				lowest[q] = e;
+			}
+		}
+		if (lowest[q] == MapGraph::INVALID_INDEX && !(graph.corner_flags[q] & (MapGraph::Ocean | MapGraph::Coast))) sinks++;
+	}
+
+	ThreadPool pool(1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned int lakes = graph.FillDepressions(pool);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned int filled_sinks = 0, changed = 0;
+	std::vector<unsigned int> upstream(graph.corner_count, 0);
+	for (unsigned int q = 0; q < graph.corner_count; q++)
+	{
+		bool ends = graph.corner_downslope_edge[q] == MapGraph::INVALID_INDEX;
+		if (ends && !(graph.corner_flags[q] & (MapGraph::Ocean | MapGraph::Coast))) filled_sinks++;
+		if (!(graph.corner_flags[q] & (MapGraph::Ocean | MapGraph::Lake)) && graph.corner_downslope_edge[q] != lowest[q]) changed++;
+		if (!ends) upstream[graph.GetDownslope(q)]++;
+	}
+	std::vector<unsigned int> ready;
+	for (unsigned int q = 0; q < graph.corner_count; q++)
+		if (upstream[q] == 0) ready.push_back(q);
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		unsigned int q = ready[i];
+		if (graph.corner_downslope_edge[q] != MapGraph::INVALID_INDEX && --upstream[graph.GetDownslope(q)] == 0)
+			ready.push_back(graph.GetDownslope(q));
+	}
+
+	printf("%-12s %9u %10.2f %10u %10u %10u %10u %10s\n", "depressions", graph.corner_count, ms, lakes,
+		sinks, filled_sinks, changed, ready.size() == graph.corner_count ? "yes" : "NO");
+}
+
+// River generation time per cell for both river models. The random sources
+// are also walked down one at a time, as the stage used to, and must give the
+// same volumes.
+void BenchRivers(int cell_count)
+{
+	const RiverModel::Type models[] = { RiverModel::RandomSources, RiverModel::Drainage };
+	const char * model_names[] = { "random", "drainage" };
+	for (int m = 0; m < 2; m++)
+	{
+		std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+		map->SetRiverModel(models[m]);
+		map->Generate();
+		const MapGraph& graph = map->GetGraph();
+
+		double ms = 0;
+		for (const std::pair<std::string,double>& time : map->GetStageTimes())
+			if (time.first == "River generation") ms = time.second;
+
+		const char * identical = "-";
+		if (models[m] == RiverModel::RandomSources)
+		{
+			std::vector<double> corner_volume(graph.corner_count, 0.0), edge_volume(graph.edge_count, 0.0);
+			Random rivers = map->GetRandom("rivers");
+			for (unsigned int i = 0; i < graph.center_count / 3; i++)
+			{
+				unsigned int q = rivers.Split(i).NextIndex(graph.corner_count);
+				if ((graph.corner_flags[q] & MapGraph::Ocean) || graph.corner_elevation[q] < 0.3 || graph.corner_elevation[q] > 0.9) continue;
+				while (!(graph.corner_flags[q] & MapGraph::Coast))
+				{
+					if (graph.corner_downslope_edge[q] == MapGraph::INVALID_INDEX) break;
+					unsigned int downslope = graph.GetDownslope(q);
+					edge_volume[graph.corner_downslope_edge[q]] += 1;
+					corner_volume[q] += 1;
+					corner_volume[downslope] += 1;
+					q = downslope;
+				}
+			}
+			identical = corner_volume == graph.corner_river_volume && edge_volume == graph.edge_river_volume ? "yes" : "NO";
+		}
+		printf("%-12s %9u %-10s %10.2f %10.1f %10s\n", "rivers", graph.center_count, model_names[m],
+			ms, ms * 1e6 / graph.center_count, identical);
+	}
+}
+
+// Cost of a trace zone while tracing is off and on, and of a traced
+// generation on 4 threads, written to MapGeneratorTrace.json.
+void BenchTrace(int cell_count)
+{
+	static const int ZONES = 1000000;
+	for (int enabled = 0; enabled < 2; enabled++)
+	{
+		Trace::SetEnabled(enabled != 0);
+		Trace::Clear();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < ZONES; i++)
+		{
+			TraceZone zone("bench");
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%-12s %9d %-8s %10.2f %10.1f %10zu %10s\n", "zone", ZONES, enabled ? "on" : "off", ms, ms * 1e6 / ZONES, Trace::GetZoneCount(), "-");
+	}
+
+	for (int enabled = 0; enabled < 2; enabled++)
+	{
+		Trace::SetEnabled(enabled != 0);
+		Trace::Clear();
+		std::unique_ptr<Map> map = MakeBenchMap(cell_count, 4);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		map->Generate();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Trace::SetEnabled(false);
+		size_t zones = Trace::GetZoneCount();
+		const char * written = "-";
+		if (enabled) written = Trace::Write("MapGeneratorTrace.json") ? "yes" : "NO";
+		printf("%-12s %9u %-8s %10.2f %10s %10zu %10s\n", "generation", map->GetGraph().center_count, enabled ? "on" : "off", ms, "-", zones, written);
+	}
+}
+
+// Whole generations through the stage graph: the sum of the stage times,
+// the critical path and the wall time, which must give the same map for any
+// number of threads. Then only the stages the center elevations need.
+void BenchPipeline(int cell_count)
+{
+	uint64_t serial_hash = 0;
+	std::string path;
+
+	const unsigned int thread_counts[] = { 1, 4, 16 };
+	for (unsigned int threads : thread_counts)
+	{
+		std::unique_ptr<Map> map = MakeBenchMap(cell_count, threads);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		map->Generate();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		double total = 0, critical = 0;
+		const std::vector<std::string>& critical_path = map->GetCriticalPath();
+		for (const std::pair<std::string,double>& time : map->GetStageTimes())
+		{
+			total += time.second;
+			if (std::find(critical_path.begin(), critical_path.end(), time.first) != critical_path.end())
+				critical += time.second;
+		}
+
+		uint64_t hash = HashGraph(map->GetGraph());
+		if (threads == 1)
+		{
+			serial_hash = hash;
+			for (const std::string& stage : critical_path)
+				path += (path.empty() ? "" : " > ") + stage;
+		}
+		printf("%-12s %9u %-8s %-8u %10.2f %10.2f %10.2f %6zu %10s\n", "pipeline", map->GetGraph().center_count, "all", threads,
+			ms, total, critical, map->GetStageTimes().size(), hash == serial_hash ? "yes" : "NO");
+	}
+
+	std::unique_ptr<Map> map = MakeBenchMap(cell_count, 1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	map->Generate(MapStage::CenterAltitude);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	double total = 0;
+	for (const std::pair<std::string,double>& time : map->GetStageTimes())
+		total += time.second;
+	printf("%-12s %9u %-8s %-8u %10.2f %10.2f %10s %6zu %10s\n", "pipeline", map->GetGraph().center_count, "altitude", 1,
+		ms, total, "-", map->GetStageTimes().size(), "-");
+	printf("critical path: %s\n", path.c_str());
+}
+
+// Every stage of the same map with 1 to 32 threads, with its speedup over a
+// single one. The graph must come out the same for any thread count.
+void BenchStages(int cell_count)
+{
+	std::vector<std::pair<std::string,double> > serial;
+	uint64_t serial_hash = 0;
+
+	const unsigned int thread_counts[] = { 1, 4, 16, 32 };
+	for (unsigned int threads : thread_counts)
+	{
+		std::unique_ptr<Map> map = MakeBenchMap(cell_count, threads);
+		map->Generate();
+
+		const std::vector<std::pair<std::string,double> >& times = map->GetStageTimes();
+		uint64_t hash = HashGraph(map->GetGraph());
+		if (threads == 1)
+		{
+			serial = times;
+			serial_hash = hash;
+		}
+
+		double total = 0, serial_total = 0;
+		for (size_t i = 0; i < times.size(); i++)
+		{
+			printf("%-24s %9u %-8u %10.2f %8.2fx\n", times[i].first.c_str(), map->GetGraph().center_count, threads,
+				times[i].second, serial[i].second / std::max(times[i].second, 0.001));
+			total += times[i].second;
+			serial_total += serial[i].second;
+		}
+		printf("%-24s %9u %-8u %10.2f %8.2fx %10s\n", "total", map->GetGraph().center_count, threads,
+			total, serial_total / std::max(total, 0.001), hash == serial_hash ? "yes" : "NO");
+	}
+}
+
+// Benchmark suite: every stage of Generate, the pointer graph export and
+// GetCenterAt queries, over several runs of maps of each size, summarized
+// as median and percentiles and written as CSV and JSON to compare
+// versions.
+//
+//	MapGeneratorBench suite [--runs N] [--threads N] [--label text]
+//		[--csv file] [--json file] [cells...]
+struct SuiteResult
+{
+	int cells;					// asked for
+	unsigned int centers;		// generated, from the last run
+	std::string stage;
+	std::vector<double> ms;		// one per run
+};
+
+// Linear interpolation between the closest ranks, p in [0, 1].
+static double Percentile(std::vector<double> values, double p)
+{
+	if (values.empty()) return 0;
+	std::sort(values.begin(), values.end());
+	double position = p * (values.size() - 1);
+	size_t below = (size_t) position;
+	if (below + 1 >= values.size()) return values.back();
+	return values[below] + (position - below) * (values[below + 1] - values[below]);
+}
+
+static SuiteResult& FindResult(std::vector<SuiteResult>& results, int cells, const std::string& stage)
+{
+	for (SuiteResult& result : results)
+		if (result.cells == cells && result.stage == stage) return result;
+	SuiteResult result;
+	result.cells = cells;
+	result.centers = 0;
+	result.stage = stage;
+	results.push_back(result);
+	return results.back();
+}
+
+// Whole positive number, nothing else.
+static bool ParsePositive(const char * text, int& r_value)
+{
+	char * end = nullptr;
+	long value = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || value <= 0 || value > 0x7fffffff) return false;
+	r_value = (int) value;
+	return true;
+}
+
+static int SuiteUsage(const std::string& error)
+{
+	fprintf(stderr, "%s\nusage: MapGeneratorBench suite [--runs N] [--threads N] [--label text] [--csv file] [--json file] [cells...]\n", error.c_str());
+	return 1;
+}
+
+// Quoted when it holds a separator, a quote or a line break, quotes doubled.
+static std::string CsvField(const std::string& text)
+{
+	if (text.find_first_of(",\"\r\n") == std::string::npos) return text;
+	std::string field = "\"";
+	for (char c : text)
+		field += c == '"' ? std::string("\"\"") : std::string(1, c);
+	return field + "\"";
+}
+
+// Quoted, with quotes, backslashes and control characters escaped.
+static std::string JsonString(const std::string& text)
+{
+	std::string string = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			string += '\\';
+			string += c;
+		}
+		else if ((unsigned char) c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int) (unsigned char) c);
+			string += escaped;
+		}
+		else string += c;
+	}
+	return string + "\"";
+}
+
+int RunSuite(int argc, char * argv[])
+{
+	static const unsigned int QUERIES = 100000;
+	unsigned int runs = 5, threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string label = "current", csv_name = "MapGeneratorBench.csv", json_name = "MapGeneratorBench.json";
+	std::vector<int> sizes;
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		int value = 0;
+		if (arg.compare(0, 2, "--") == 0)
+		{
+			if (arg != "--runs" && arg != "--threads" && arg != "--label" && arg != "--csv" && arg != "--json")
+				return SuiteUsage("Unknown option " + arg + ".");
+			if (i + 1 >= argc)
+				return SuiteUsage("Missing value of " + arg + ".");
+			std::string text = argv[++i];
+			if ((arg == "--runs" || arg == "--threads") && !ParsePositive(text.c_str(), value))
+				return SuiteUsage("The value of " + arg + " must be a positive number, not " + text + ".");
+
+			if (arg == "--runs") runs = (unsigned int) value;
+			else if (arg == "--threads") threads = (unsigned int) value;
+			else if (arg == "--label") label = text;
+			else if (arg == "--csv") csv_name = text;
+			else json_name = text;
+		}
+		else if (ParsePositive(argv[i], value)) sizes.push_back(value);
+		else return SuiteUsage("The cell counts must be positive numbers, not " + arg + ".");
+	}
+	if (sizes.empty())
+	{
+		sizes.push_back(1000);
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+	}
+
+	std::vector<SuiteResult> results;
+	for (int size : sizes)
+	{
+		double spread = 2.0;
+		double scale = std::sqrt(size * 3.1416 * spread * spread / (2.0 * 800 * 600));
+		for (unsigned int run = 0; run < runs; run++)
+		{
+			// The same map every run.
+			std::unique_ptr<Map> map = MakeBenchMap(size, threads);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			map->Generate();
+			double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			unsigned int centers = map->GetGraph().center_count;
+
+			for (const std::pair<std::string,double>& time : map->GetStageTimes())
+				FindResult(results, size, time.first).ms.push_back(time.second);
+			FindResult(results, size, "Generate").ms.push_back(total);
+
+			// The first query builds the pointer graph.
+			start = std::chrono::steady_clock::now();
+			map->GetCenterAt(Vec2(0, 0));
+			FindResult(results, size, "Pointer graph export").ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+			Random random = map->GetRandom("queries");
+			std::vector<Vec2> positions(QUERIES);
+			for (Vec2& position : positions)
+				position = Vec2(random.NextDouble() * 800 * scale, random.NextDouble() * 600 * scale);
+			size_t found = 0;
+			start = std::chrono::steady_clock::now();
+			for (const Vec2& position : positions)
+				found += map->GetCenterAt(position) != nullptr;
+			FindResult(results, size, "GetCenterAt x100000").ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			if (found == 0) printf("no center found for %d cells\n", size);
+
+			for (SuiteResult& result : results)
+				if (result.cells == size) result.centers = centers;
+		}
+	}
+
+	printf("\n%-10s %9s %-26s %10s %10s %10s %10s %10s\n", "cells", "centers", "stage", "median ms", "p10", "p90", "min", "max");
+	for (const SuiteResult& result : results)
+	{
+		printf("%-10d %9u %-26s %10.3f %10.3f %10.3f %10.3f %10.3f\n", result.cells, result.centers, result.stage.c_str(),
+			Percentile(result.ms, 0.5), Percentile(result.ms, 0.1), Percentile(result.ms, 0.9),
+			Percentile(result.ms, 0), Percentile(result.ms, 1));
+	}
+
+	FILE * csv = fopen(csv_name.c_str(), "w");
+	if (csv)
+	{
+		fprintf(csv, "label,threads,runs,cells,centers,stage,median_ms,p10_ms,p90_ms,min_ms,max_ms\n");
+		for (const SuiteResult& result : results)
+		{
+			fprintf(csv, "%s,%u,%u,%d,%u,%s,%.4f,%.4f,%.4f,%.4f,%.4f\n", CsvField(label).c_str(), threads, runs, result.cells, result.centers,
+				CsvField(result.stage).c_str(), Percentile(result.ms, 0.5), Percentile(result.ms, 0.1), Percentile(result.ms, 0.9),
+				Percentile(result.ms, 0), Percentile(result.ms, 1));
+		}
+		fclose(csv);
+	}
+
+	FILE * json = fopen(json_name.c_str(), "w");
+	if (json)
+	{
+		fprintf(json, "{\"label\":%s,\"threads\":%u,\"runs\":%u,\"results\":[", JsonString(label).c_str(), threads, runs);
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SuiteResult& result = results[i];
+			fprintf(json, "%s\n{\"cells\":%d,\"centers\":%u,\"stage\":%s,\"median_ms\":%.4f,\"p10_ms\":%.4f,\"p90_ms\":%.4f,\"min_ms\":%.4f,\"max_ms\":%.4f,\"ms\":[",
+				i ? "," : "", result.cells, result.centers, JsonString(result.stage).c_str(), Percentile(result.ms, 0.5), Percentile(result.ms, 0.1),
+				Percentile(result.ms, 0.9), Percentile(result.ms, 0), Percentile(result.ms, 1));
+			for (size_t r = 0; r < result.ms.size(); r++)
+				fprintf(json, "%s%.4f", r ? "," : "", result.ms[r]);
+			fprintf(json, "]}");
+		}
+		fprintf(json, "\n]}\n");
+		fclose(json);
+	}
+
+	printf("\nWritten to %s (%s) and %s (%s).\n", csv_name.c_str(), csv ? "ok" : "failed", json_name.c_str(), json ? "ok" : "failed");
+	return csv && json ? 0 : 1;
+}
+
+// Checks of the precomputed tiles, for ctest: the samples they lay out over
+// a few areas and spreads keep the min distance and leave no holes, and the
+// set reads back from its file giving the same samples. Returns 0 when all
+// of them pass.
+int RunTileSetChecks()
+{
+	static const double TOLERANCE = 1e-4;	// the tiles are stored as floats
+	PoissonTileSet tile_set;
+	tile_set.Build(2, 16, 30, Random(1));
+
+	bool passed = true;
+	printf("%-12s %9s %8s %12s %10s %6s\n", "check", "samples", "spread", "min distance", "max gap", "ok");
+	const double spreads[] = { 1.0, 2.0, 7.5 };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		double spread = spreads[i];
+		int width = (int) (400 * spread), height = (int) (300 * spread);
+		std::vector<std::pair<double,double> > samples = tile_set.Generate(width, height, spread, Random(i));
+		double min_distance, max_gap;
+		MeasureSpacing(samples, width, height, spread, min_distance, max_gap);
+		bool ok = !samples.empty() && min_distance >= spread * (1 - TOLERANCE) && max_gap < spread * 2;
+		passed = passed && ok;
+		printf("%-12s %9zu %8.2f %12.5f %10.3f %6s\n", "spacing", samples.size(), spread, min_distance, max_gap, ok ? "yes" : "NO");
+	}
+
+	std::string file_name = "poisson_tiles_check.bin";
+	PoissonTileSet loaded;
+	bool saved = tile_set.Save(file_name);
+	bool read = saved && loaded.Load(file_name);
+	bool identical = read && loaded.GetTileCount() == tile_set.GetTileCount() && loaded.GetTileSize() == tile_set.GetTileSize()
+		&& loaded.Generate(1000, 1000, 2.0, Random(7)) == tile_set.Generate(1000, 1000, 2.0, Random(7));
+	passed = passed && identical;
+	printf("%-12s %9d %8s %12s %10s %6s\n", "reload", tile_set.GetTileCount(), "-", "-", "-", identical ? "yes" : "NO");
+
+	// A file cut short, and one whose sample count is larger than the file,
+	// must not load.
+	std::vector<char> bytes;
+	FILE * file = fopen(file_name.c_str(), "rb");
+	if (file)
+	{
+		char buffer[4096];
+		for (size_t read_bytes; (read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+			bytes.insert(bytes.end(), buffer, buffer + read_bytes);
+		fclose(file);
+	}
+	// Magic, version, colours, offset count and tile size, then the offsets.
+	size_t last_offset = 4 + 3 * sizeof(unsigned int) + sizeof(float) + tile_set.GetTileCount() * sizeof(unsigned int);
+	bool rejected = bytes.size() > last_offset + sizeof(unsigned int);
+	for (int corruption = 0; corruption < 2 && rejected; corruption++)
+	{
+		std::vector<char> corrupt = bytes;
+		if (corruption == 0)
+		{
+			corrupt.resize(corrupt.size() - sizeof(float));
+		}
+		else
+		{
+			unsigned int huge = 0x7fffffff;
+			memcpy(&corrupt[last_offset], &huge, sizeof(huge));
+		}
+		file = fopen(file_name.c_str(), "wb");
+		rejected = file && fwrite(corrupt.data(), 1, corrupt.size(), file) == corrupt.size();
+		if (file) fclose(file);
+		PoissonTileSet corrupt_set;
+		rejected = rejected && !corrupt_set.Load(file_name);
+	}
+	std::remove(file_name.c_str());
+	passed = passed && rejected;
+	printf("%-12s %9d %8s %12s %10s %6s\n", "corrupt", tile_set.GetTileCount(), "-", "-", "-", rejected ? "yes" : "NO");
+
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char * argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "suite")
+		return RunSuite(argc - 2, argv + 2);
+	if (argc > 1 && std::string(argv[1]) == "check")
+		return RunTileSetChecks();
+
+	std::vector<int> sizes;
+	for (int i = 1; i < argc; i++)
+		sizes.push_back(atoi(argv[i]));
+	if (sizes.empty())
+	{
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+	}
+
+	printf("%-12s %9s %-8s %10s %14s\n", "stage", "points", "order", "ms", "cache misses");
+	for (int size : sizes)
+	{
+		std::vector<del::vertex> points = MakePoints(size);
+		BenchTriangulation(points, "input");
+		BenchTriangulation(points, "sorted");
+		BenchTriangulation(points, "hilbert");
+		BenchTriangulation(points, "brio");
+	}
+
+	// The multithreaded triangulation must give exactly the serial result.
+	printf("\n%-12s %9s %-8s %10s %10s\n", "stage", "points", "threads", "ms", "identical");
+	for (int size : sizes)
+	{
+		std::vector<del::vertex> points = MakePoints(size);
+		del::HilbertSort(points);
+
+		del::Triangulator serial;
+		serial.Triangulate(points);
+
+		unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned int threads = 1; threads <= std::max(hardware, 2u); threads *= 2)
+		{
+			del::Triangulator triangulator;
+			triangulator.SetThreadCount(threads);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			triangulator.Triangulate(points);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			bool identical = triangulator.GetTriangles() == serial.GetTriangles() && triangulator.GetHalfedges() == serial.GetHalfedges();
+			printf("%-12s %9zu %-8u %10.2f %10s\n", "parallel", points.size(), threads, ms, identical ? "yes" : "NO");
+		}
+	}
+
+	// The precomputed tiles, built once and saved to a file and back.
+	PoissonTileSet tile_set;
+	printf("\n%-12s %9s %-10s %10s %10s\n", "stage", "tiles", "step", "ms", "reloaded");
+	BenchTileSet(tile_set);
+
+	// The tiled sampler gives the same samples for any number of threads.
+	printf("\n%-12s %9s %-10s %10s %10s %12s %10s\n", "stage", "samples", "sampler", "ms", "allocs", "min distance", "max gap");
+	for (int size : sizes)
+	{
+		BenchSampling(size, 0);
+		unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned int threads = 1; threads <= std::max(hardware, 2u); threads *= 2)
+			BenchSampling(size, threads);
+		BenchSampling(size, 0, &tile_set);
+	}
+
+	// The variable density map uses the same spread near the coast, and four
+	// times that over open ocean.
+	printf("\n%-12s %9s %10s %16s %16s %12s %12s\n", "stage", "cells", "ms", "graph B/cell", "pointer B/cell", "allocs", "export allocs");
+	for (int size : sizes)
+	{
+		BenchMap(size, PointSampler::Serial);
+		BenchMap(size, PointSampler::Variable);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %10s %10s\n", "stage", "corners", "queue", "ms", "pushes", "identical");
+	for (int size : sizes)
+	{
+		BenchCornerElevation(size);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %10s %10s\n", "stage", "elements", "threads", "ms", "levels", "identical");
+	for (int size : sizes)
+	{
+		BenchPropagation(size);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %9s %10s\n", "stage", "corners", "threads", "ms", "speedup", "stable");
+	for (int size : sizes)
+	{
+		BenchRankSort(size);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %10s %10s %10s %10s\n", "stage", "cells", "threads", "ms", "ms/iter", "mean drop", "max drop", "identical");
+	for (int size : sizes)
+	{
+		BenchErosion(size);
+	}
+
+	printf("\n%-12s %9s %10s %10s %10s %10s %10s %10s\n", "stage", "corners", "ms", "lakes", "sinks", "filled", "changed", "forest");
+	for (int size : sizes)
+	{
+		BenchDepressions(size);
+	}
+
+	printf("\n%-12s %9s %-10s %10s %10s %10s\n", "stage", "cells", "model", "ms", "ns/cell", "identical");
+	for (int size : sizes)
+	{
+		BenchRivers(size);
+	}
+
+	// Trace zones, off and on.
+	printf("\n%-12s %9s %-8s %10s %10s %10s %10s\n", "stage", "count", "trace", "ms", "ns/zone", "zones", "written");
+	BenchTrace(sizes.back());
+
+	// Generations through the stage graph.
+	printf("\n%-12s %9s %-8s %-8s %10s %10s %10s %6s %10s\n", "stage", "cells", "stages", "threads", "ms", "stage ms", "critical", "run", "identical");
+	for (int size : sizes)
+	{
+		BenchPipeline(size);
+	}
+
+	// The per-element stages on the map's thread pool.
+	printf("\n%-24s %9s %-8s %10s %9s %10s\n", "stage", "cells", "threads", "ms", "speedup", "identical");
+	for (int size : sizes)
+	{
+		BenchStages(size);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %12s\n", "stage", "points", "method", "ms", "max error");
+	for (int size : sizes)
+	{
+		BenchLandNoise(size);
+	}
+
+	printf("\n%-12s %9s %9s %10s %12s %12s %12s\n", "stage", "cells", "side", "ms", "us/cell", "peak B/cell", "min spacing");
+	for (int size : sizes)
+	{
+		BenchWorld(size);
+	}
+
+	printf("\n%-12s %9s %-8s %10s %10s\n", "stage", "points", "lookup", "ms", "edges");
+	for (int size : sizes)
+	{
+		BenchGraphBuild(MakePoints(size));
+	}
+
+	printf("\n%-12s %9s %-10s %10s %12s\n", "stage", "triangles", "method", "ms", "max error");
+	for (int size : sizes)
+	{
+		BenchCircumcenters(MakePoints(size));
+	}
+
+	return 0;
+}
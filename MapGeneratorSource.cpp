@@ -124,9 +124,16 @@ int main()
 	ImGui::SFML::Init(app);
 
 	Map mapa(WIDTH, HEIGHT, 10, "");
+	std::cout << "Seed: " << mapa.GetSeed() << std::endl;
 
 	timer.restart();
 	mapa.Generate();
+	for (const std::pair<std::string,double>& time : mapa.GetStageTimes())
+		std::cout << time.first << ": " << time.second << " ms." << std::endl;
+	std::cout << "Critical path:";
+	for (size_t i = 0; i < mapa.GetCriticalPath().size(); i++)
+		std::cout << (i ? " > " : " ") << mapa.GetCriticalPath()[i];
+	std::cout << std::endl;
 	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << std::endl;
 
 	std::vector<edge*> edges = mapa.GetEdges();
@@ -149,13 +156,16 @@ int main()
 		polygons.push_back(polygon);
 	}
 
+	mng.setRandom(mapa.GetRandom("names"));
+	Random cities_random = mapa.GetRandom("cities");
+
 	std::vector<city> cities;
 	for (int i = 0; i < 5; i++)
 	{
 		city city;
 		do 
 		{
-			city.cell = centers[rand() % centers.size()];
+			city.cell = centers[cities_random.NextIndex(centers.size())];
 		} while (city.cell->water);
 
 		city.name = mng.getName();
@@ -1,15 +1,35 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <cmath>
+#include "Random/Random.h"
 
-class PoissonDiskSampling 
+// Bridson's Poisson disk sampling.
+//
+// The background grid has cells of min_dist / sqrt(2), so every cell holds
+// at most one sample, and is stored flat as the float coordinates of that
+// sample (EMPTY_CELL if none). It has a margin of two empty cells on every
+// side, so the 5x5 window around a candidate never needs bounds checks.
+// Samples are taken out of the active list by swapping them with the last
+// one, and nothing is allocated per sample besides the output. The random
+// numbers come from the given stream, which decides the result.
+class PoissonDiskSampling
 {
 public:
-	PoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count);
+	typedef std::function<bool(double, double)> InsideFunction;
+
+	PoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count, const Random& p_random);
 
 	std::vector<std::pair<double,double>> Generate();
 
+	// Fills only the part of the area where p_inside holds, growing from
+	// p_fixed: samples placed before, possibly a little outside the area,
+	// that the new ones keep their distance to. They must keep the min
+	// distance between them too, and are not returned.
+	std::vector<std::pair<double,double>> Generate(const std::vector<std::pair<double,double>>& p_fixed,
+		const InsideFunction& p_inside);
+
 	struct point
 	{
 		point(double x_, double y_) : x(x_), y(y_) {};
@@ -33,21 +53,28 @@ public:
 
 
 private:
-	
-	std::vector<std::vector<point*>> m_grid;
-	std::vector<point> m_process;
+	static const int GRID_MARGIN = 2;
+
+	std::vector<float> m_grid;			// x, y per cell
+	std::vector<unsigned int> m_active;	// indices in m_sample
 	std::vector<std::pair<double,double>> m_sample;
+	Random m_stream;
+	Random m_random;	// m_stream, advanced while generating
 
 	int m_width;
 	int m_height;
 	double m_min_dist;
 	int m_point_count;
 	double m_cell_size;
+	double m_inv_cell_size;
 	int m_grid_width;
 	int m_grid_height;
 
-	point generatePointAround(point p_point);
+	void reset();
+	void grow(const InsideFunction * p_inside);
+	point generatePointAround(point p_point, double p_dir_x, double p_dir_y);
 	bool inRectangle(point p_point);
 	bool inNeighbourhood(point p_point);
-	std::vector<point *> getCellsAround(point p_point);
+	void addSample(point p_point);
+	size_t cellIndex(point p_point);
 };
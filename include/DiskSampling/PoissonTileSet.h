@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Random/Random.h"
+
+// Precomputed Poisson disk tiles, laid next to each other like Wang tiles.
+//
+// Distances are in units of the min distance, and every tile is tile_size
+// of them wide. Each tile edge gets one of a few colours per direction, and
+// the set holds one tile for every combination of its four edges, so any
+// random colouring of the edges can be tiled. The samples along an edge,
+// up to half the min distance on both sides, depend only on its colour, and
+// the ones around the corners are the same for every corner, so two tiles
+// that share an edge colour keep the min distance across it. The inside of
+// every tile is filled by PoissonDiskSampling around its edges and corners.
+//
+// Building the set takes a while and is meant to be done once and saved;
+// generating a point set afterwards only copies tiles.
+class PoissonTileSet
+{
+public:
+	PoissonTileSet();
+
+	// p_colours ^ 4 tiles of p_tile_size min distances.
+	void Build(int p_colours, int p_tile_size, int p_point_count, const Random& p_random);
+
+	// Binary file in the byte order of the machine.
+	bool Save(const std::string& p_file_name) const;
+	bool Load(const std::string& p_file_name);
+
+	bool IsEmpty() const;
+	int GetTileCount() const;
+	double GetTileSize() const;
+
+	// Samples of the area, min_dist apart, with the edge colours, and so the
+	// tiles, picked by the given stream.
+	std::vector<std::pair<double,double>> Generate(int p_width, int p_height, double p_min_dist, const Random& p_random) const;
+
+private:
+	int m_colours;
+	float m_tile_size;
+	std::vector<float> m_points;			// x, y per sample, inside its tile
+	std::vector<unsigned int> m_offsets;	// first sample of every tile, and the end
+
+	int tileIndex(int p_north, int p_east, int p_south, int p_west) const;
+};
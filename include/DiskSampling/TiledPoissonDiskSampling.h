@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "Random/Random.h"
+
+// Poisson disk sampling split in square tiles that are filled in parallel.
+//
+// The tiles are coloured like a 2x2 checkerboard and filled one colour at a
+// time, so the tiles running together are a whole tile apart and never read
+// or write the same grid cells. A tile starts from the samples its finished
+// neighbours left close to its border, or from a random point if there are
+// none, and only keeps candidates that fall inside it, so the minimum
+// distance holds across the borders too. Every tile draws from its own split
+// of the given stream, and the samples are returned in tile order, which
+// makes the result the same for any thread count.
+class TiledPoissonDiskSampling
+{
+public:
+	TiledPoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count, const Random& p_random);
+
+	void SetThreadCount(unsigned int p_thread_count);
+
+	std::vector<std::pair<double,double>> Generate();
+
+private:
+	static const int SEED_RING = 3;		// a candidate lies less than 2 min_dist, 3 cells, away from its sample
+	static const int GRID_MARGIN = SEED_RING;	// the seed ring around a tile
+	static const int TILE_CELLS = 32;	// wider than the seed ring, so the tiles of a colour stay apart
+
+	std::vector<float> m_grid;			// x, y per cell, same layout as PoissonDiskSampling
+	std::vector<std::vector<std::pair<double,double>>> m_tile_samples;
+
+	int m_width;
+	int m_height;
+	double m_min_dist;
+	int m_point_count;
+	Random m_random;
+	unsigned int m_thread_count;
+	double m_cell_size;
+	double m_inv_cell_size;
+	int m_grid_width;
+	int m_grid_height;
+	int m_tiles_x;
+	int m_tiles_y;
+
+	void fillTile(int p_tile, std::vector<std::pair<double,double>>& r_active);
+	bool inNeighbourhood(double p_x, double p_y) const;
+	void cellOf(double p_x, double p_y, int& r_x, int& r_y) const;
+};
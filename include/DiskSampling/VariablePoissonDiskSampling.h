@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Random/Random.h"
+
+// Poisson disk sampling with a minimum distance that changes over the area.
+//
+// The distance at a position comes from a user function and must stay in
+// [min_dist, max_dist]. A candidate is rejected if any sample is closer than
+// the distance at the candidate, so a dense region can grow right up to the
+// samples of a sparse one. The grid uses the cells of min_dist, and the
+// window around a candidate grows with its distance, so sparse regions cost
+// about as much per area as dense ones but give far fewer samples.
+// Like PoissonDiskSampling, the random numbers come from the given stream.
+class VariablePoissonDiskSampling
+{
+public:
+	typedef std::function<double(double, double)> DistanceFunction;
+
+	VariablePoissonDiskSampling(int p_width, int p_height, double p_min_dist, double p_max_dist,
+		DistanceFunction p_distance, int p_point_count, const Random& p_random);
+
+	std::vector<std::pair<double,double>> Generate();
+
+private:
+	std::vector<float> m_grid;			// x, y per cell
+	std::vector<unsigned int> m_active;	// indices in m_sample
+	std::vector<std::pair<double,double>> m_sample;
+	std::vector<float> m_sample_dist;	// distance at every sample
+	Random m_random;
+	DistanceFunction m_distance;
+
+	int m_width;
+	int m_height;
+	double m_min_dist;
+	double m_max_dist;
+	int m_point_count;
+	double m_cell_size;
+	double m_inv_cell_size;
+	int m_grid_margin;
+	int m_grid_width;
+	int m_grid_height;
+
+	bool inNeighbourhood(double p_x, double p_y, double p_dist);
+	void addSample(double p_x, double p_y, double p_dist);
+	size_t cellIndex(double p_x, double p_y);
+};
@@ -0,0 +1,85 @@
+// Arena
+// Bump allocator for objects that are created together and die together.
+//
+// Memory is handed out from large blocks and only given back all at once by
+// Release() or the destructor; the objects' destructors are not run, so the
+// arena is only meant for objects that own nothing outside of it (the graph
+// nodes, whose adjacency lists use ArenaAllocator on the same arena).
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Arena
+{
+public:
+	Arena(size_t p_block_size = 1 << 16);
+	~Arena();
+
+	void * Allocate(size_t p_size, size_t p_align);
+
+	template <class T, class... Args>
+	T * New(Args&&... p_args)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(p_args)...);
+	}
+
+	// Frees every block.
+	void Release();
+
+	size_t GetBlockCount() const	{ return m_blocks.size(); }
+	size_t GetBytesUsed() const		{ return m_bytes_used; }
+
+private:
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+
+	std::vector<char *> m_blocks;
+	char * m_current;
+	size_t m_left;
+	size_t m_next_block_size;
+	size_t m_first_block_size;
+	size_t m_bytes_used;
+};
+
+// Standard allocator on top of an Arena, so containers can keep their storage
+// next to the nodes. deallocate() is a no-op, the memory goes back with the
+// arena. Without an arena it falls back to the global heap.
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ArenaAllocator() : m_arena(nullptr) {}
+	ArenaAllocator(Arena * p_arena) : m_arena(p_arena) {}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& p_other) : m_arena(p_other.m_arena) {}
+
+	T * allocate(size_t n)
+	{
+		if (m_arena != nullptr)
+			return static_cast<T *>(m_arena->Allocate(n * sizeof(T), alignof(T)));
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T * p, size_t)
+	{
+		if (m_arena == nullptr)
+			::operator delete(p);
+	}
+
+	template <class U>
+	bool operator==(const ArenaAllocator<U>& p_other) const	{ return m_arena == p_other.m_arena; }
+	template <class U>
+	bool operator!=(const ArenaAllocator<U>& p_other) const	{ return m_arena != p_other.m_arena; }
+
+	Arena * m_arena;
+};
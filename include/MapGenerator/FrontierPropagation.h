@@ -0,0 +1,67 @@
+// FrontierPropagation
+// Breadth first propagation over a CSR graph, one level at a time.
+//
+// The indices to expand in a level are the set bits of a bitmap. Every level
+// is split over the words of the bitmap on a ThreadPool, and the neighbours
+// that change are set, with an atomic or, in the bitmap of the next one. A
+// flood claims an index by setting its bit in the visited bitmap, and a
+// propagation raises a value with an atomic max, so a neighbour reached from
+// two threads at once is still expanded once per change. Both end on the
+// same fixed point a serial queue reaches, whatever the thread count. When
+// the pool has a single thread they work in place from a FIFO queue.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Forward Declarations
+class ThreadPool;
+
+class FrontierPropagation
+{
+public:
+	explicit FrontierPropagation(ThreadPool& p_pool);
+
+	// Adds p_mark to the flags of p_seeds and of every index reachable from
+	// them through indices with all the bits of p_through. Indices that
+	// already have p_mark are not entered.
+	void Flood(const std::vector<unsigned int>& p_offsets, const std::vector<unsigned int>& p_adjacency,
+		const std::vector<unsigned int>& p_seeds, unsigned char p_through, unsigned char p_mark, std::vector<unsigned char>& r_flags);
+
+	// Raises r_values[s] to r_values[q] * p_factor for every neighbour s of
+	// q, starting from p_seeds, until no value changes. The values must not
+	// be negative.
+	void PropagateMax(const std::vector<unsigned int>& p_offsets, const std::vector<unsigned int>& p_adjacency,
+		const std::vector<unsigned int>& p_seeds, double p_factor, std::vector<double>& r_values);
+
+	// Levels run by the last call.
+	unsigned int GetLevelCount() const;
+
+private:
+	typedef std::atomic<uint64_t> Word;
+
+	ThreadPool& m_pool;
+	size_t m_size;
+	size_t m_word_count;
+	std::unique_ptr<Word[]> m_frontier;
+	std::unique_ptr<Word[]> m_next;
+	std::unique_ptr<Word[]> m_visited;
+	std::unique_ptr<std::atomic<double>[]> m_values;
+	unsigned int m_level_count;
+	bool m_serial;						// single thread, m_queue instead of levels
+	std::vector<unsigned int> m_queue;
+
+	void reset(size_t p_size, const std::vector<unsigned int>& p_seeds);
+	// Calls p_expand on every index of the frontier, level after level, while
+	// it sets bits in the next one.
+	template <typename Expand>
+	void run(const Expand& p_expand);
+	// Each is true if the call changed the index: set its visited bit, raised
+	// its value, or set its bit in the next frontier.
+	bool claim(unsigned int p_index);
+	bool raise(unsigned int p_index, double p_value);
+	bool setNext(unsigned int p_index);
+};
@@ -2,14 +2,86 @@
 
 #include "dDelaunay.h"
 #include "Structures.h"
+#include "MapGraph.h"
 #include "Quadtree.h"
+#include "Arena.h"
+#include "Math/PerlinSlice.h"
+#include "ThreadPool.h"
+#include "FrontierPropagation.h"
+#include "StageGraph.h"
+#include "Random/Random.h"
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
-#include <map>
 
-typedef QuadTree<center *> CenterPointerQT;
+typedef QuadTree<unsigned int> CenterIndexQT;
+
+// Order in which the generated points reach the triangulator
+struct InsertionOrder
+{
+	enum Type
+	{
+		Input,		// As generated by the Poisson Disk Sampling
+		Hilbert,	// Along a Hilbert curve
+		Brio		// Biased randomized insertion order
+	};
+};
+
+// Sampler that places the points of the cells
+struct PointSampler
+{
+	enum Type
+	{
+		Serial,		// PoissonDiskSampling
+		Tiled,		// TiledPoissonDiskSampling, uses the thread count of the map
+		Variable,	// VariablePoissonDiskSampling, the point spread near the coast
+					// growing to the coarse spread over open ocean
+		TileSet		// Copies of the tiles given with SetTileSet, Serial without them
+	};
+};
+
+// Where the rivers start
+struct RiverModel
+{
+	enum Type
+	{
+		RandomSources,	// A third as many random corners as there are centers
+		Drainage		// Every corner a source could fall on, with its expected
+						// share of them
+	};
+};
+
+// Stages of Generate, to run only some of them
+struct MapStage
+{
+	enum Type
+	{
+		PointPlacement = 1 << 0,
+		Triangulation = 1 << 1,
+		FinishingTouches = 1 << 2,
+		LandDistribution = 1 << 3,
+		CoastAssignment = 1 << 4,
+		CornerAltitude = 1 << 5,
+		AltitudeRedistribution = 1 << 6,
+		Erosion = 1 << 7,				// only with erosion iterations
+		CenterAltitude = 1 << 8,
+		Downslopes = 1 << 9,
+		RiverGeneration = 1 << 10,
+		CornerMoisture = 1 << 11,
+		MoistureRedistribution = 1 << 12,
+		CenterMoisture = 1 << 13,
+		BiomeAssignment = 1 << 14,
+		Quadtree = 1 << 15,
+
+		Polygons = PointPlacement | Triangulation | FinishingTouches,
+		All = 0xffff
+	};
+};
 
 // Forward Declarations
 class Vec2;
+class PoissonTileSet;
 namespace noise
 {
 	namespace module
@@ -22,8 +94,12 @@ class Map
 {
 public:
 	Map(int width, int height, double point_spread, std::string seed);
+	~Map();
 
-	void Generate();
+	// Runs the stages in p_stages, a mask of MapStage, and the ones they
+	// need, each as soon as those are done, next to each other when they
+	// don't touch the same data.
+	void Generate(unsigned int p_stages = MapStage::All);
 
 	void GeneratePolygons();
 	void GenerateLand();
@@ -37,18 +113,63 @@ public:
 
 	center * GetCenterAt(Vec2 p_pos);
 
+	// The stages work on this graph, the pointer nodes above are built from
+	// it the first time they are requested.
+	const MapGraph& GetGraph() const;
+
+	void SetInsertionOrder(InsertionOrder::Type p_order);
+	void SetPointSampler(PointSampler::Type p_sampler);
+	void SetCoarseSpread(double p_spread);
+	void SetRiverModel(RiverModel::Type p_model);
+	// Iterations of the erosion stage after the redistribution of the
+	// elevations, none by default.
+	void SetErosionIterations(unsigned int p_iterations);
+	// Not owned, so one set can be shared by every map.
+	void SetTileSet(const PoissonTileSet * p_tile_set);
+	void SetThreadCount(unsigned int p_thread_count);
+
+	// The seed given, or the one made up when it was empty.
+	const std::string& GetSeed() const;
+	// Stream of random numbers of this map, independent of the ones the
+	// stages use as long as the name is different.
+	Random GetRandom(const std::string& p_stream) const;
+
+	// Name and milliseconds of every stage of the last generation, in order.
+	const std::vector<std::pair<std::string,double> >& GetStageTimes() const;
+	// The stages of the last generation no number of threads can overlap,
+	// the longest chain of them that need each other.
+	const std::vector<std::string>& GetCriticalPath() const;
+
 private:
 	int map_width;
 	int map_height;
 	double m_point_spread;
+	double m_coarse_spread;
 	double z_coord;
-	noise::module::Perlin * noiseMap;
+	std::unique_ptr<noise::module::Perlin> noiseMap;
+	PerlinSlice m_land_noise;	// noiseMap at z_coord
 	std::string m_seed;
-	CenterPointerQT m_centers_quadtree;
+	Random m_random;	// keyed on the seed, split by stage
+	InsertionOrder::Type m_insertion_order;
+	PointSampler::Type m_point_sampler;
+	RiverModel::Type m_river_model;
+	unsigned int m_erosion_iterations;
+	const PoissonTileSet * m_tile_set;
+	unsigned int m_thread_count;
+	ThreadPool m_thread_pool;	// runs the per-element stages
+	FrontierPropagation m_propagation;	// flood fills and moisture, on m_thread_pool
+	StageGraph m_stages;
+	std::vector<unsigned int> m_stage_masks;	// MapStage of every stage
+	std::vector<std::pair<std::string,double> > m_stage_times;
+	std::vector<std::string> m_critical_path;
+	Arena m_quadtree_arena;
+	CenterIndexQT m_centers_quadtree;
 
 	std::vector<del::vertex> points;
 
-	std::map<double, std::map<double, center *> > pos_cen_map;
+	MapGraph m_graph;
+	Arena m_arena;	// pointer nodes exported from m_graph
+	bool m_pointer_graph_ready;
 	std::vector<edge *> edges;
 	std::vector<corner *> corners;
 	std::vector<center *> centers;
@@ -57,28 +178,34 @@ private:
 	static std::vector<std::vector<Biome::Type> > MakeBiomeMatrix();
 
 	bool IsIsland(Vec2 position);
+	double IslandMargin(Vec2 position);
+	void IslandMargins(const Vec2 * p_positions, size_t p_count, float * r_margins);
+	void ResetLandNoise();
 	void AssignOceanCoastLand();
 	void AssignCornerElevation();
 	void RedistributeElevations();
+	void ErodeElevations();
 	void AssignPolygonElevations();
 	void CalculateDownslopes();
 	void GenerateRivers();
 	void AssignCornerMoisture();
 	void RedistributeMoisture();
+	void RedistributeByRank(std::vector<double>& r_values, const std::function<double(double)>& p_curve);
 	void AssignPolygonMoisture();
 	void AssignBiomes();
 
 	void GeneratePoints();
-	void Triangulate(std::vector<del::vertex> puntos);
+	void Triangulate(const std::vector<del::vertex>& puntos);
 	void FinishInfo();
-	void AddCenter(center * c);
-	center * GetCenter(Vec2 position);
 	void OrderPoints(std::vector<corner *> &corners);
 
-	std::vector<corner *> GetLandCorners();
-	std::vector<corner *> GetLakeCorners();
+	void DeclareStages();
+	void PopulateQuadtree();
+	void ExportPointerGraph();
+
+	std::vector<unsigned int> GetLandCorners();
+	std::vector<unsigned int> GetLakeCorners();
 	void LloydRelaxation();
-	static unsigned int HashString(std::string seed);
 	std::string CreateSeed(int length);
 };
 
@@ -0,0 +1,136 @@
+// MapGraph
+// Compact index based version of the center/corner/edge graph.
+//
+// Every element is a 32-bit index into per-attribute arrays, and the
+// variable sized adjacency lists are stored as CSR: the neighbours of i are
+// list[offset[i]] .. list[offset[i + 1] - 1]. A corner is a Delaunay
+// triangle, so it always has exactly 3 centers and 3 edges and those lists
+// need no offsets. The orders match the ones of the pointer graph, so the
+// stages give the same results on both.
+
+#pragma once
+
+#include "dTriangulator.h"
+#include "Structures.h"
+#include "Math/Vec2.h"
+#include <vector>
+
+class ThreadPool;
+
+struct MapGraph
+{
+	static const unsigned int INVALID_INDEX = del::Triangulator::INVALID_INDEX;
+
+	// Bits of center_flags and corner_flags
+	enum Flag
+	{
+		Water = 1,
+		Ocean = 2,
+		Coast = 4,
+		Border = 8,
+		Lake = 16		// corners only, in a depression filled by FillDepressions
+	};
+
+	unsigned int center_count;
+	unsigned int corner_count;
+	unsigned int edge_count;
+
+	// Centers
+	std::vector<Vec2> center_position;
+	std::vector<double> center_elevation;
+	std::vector<double> center_moisture;
+	std::vector<unsigned char> center_flags;
+	std::vector<unsigned char> center_biome;
+	std::vector<unsigned int> center_corners_offset;	// corners sorted around the center
+	std::vector<unsigned int> center_corners;
+	std::vector<unsigned int> center_centers_offset;	// in edge order
+	std::vector<unsigned int> center_centers;
+
+	// Corners
+	std::vector<Vec2> corner_position;
+	std::vector<double> corner_elevation;
+	std::vector<double> corner_moisture;
+	std::vector<double> corner_river_volume;
+	std::vector<unsigned char> corner_flags;
+	std::vector<unsigned int> corner_downslope_edge;	// INVALID_INDEX if there is no downslope
+	std::vector<unsigned int> corner_centers;			// 3 per corner
+	std::vector<unsigned int> corner_edges;				// 3 per corner
+	std::vector<unsigned int> corner_corners_offset;
+	std::vector<unsigned int> corner_corners;
+
+	// Edges
+	std::vector<unsigned int> edge_centers;				// d0, d1
+	std::vector<unsigned int> edge_corners;				// v0, v1 (INVALID_INDEX on the hull)
+	std::vector<double> edge_river_volume;
+
+	MapGraph() : center_count(0), corner_count(0), edge_count(0) {}
+
+	// Creates one center per point used by the triangulation, in input order,
+	// one corner per triangle and one edge per pair of twin half-edges.
+	void Build(const std::vector<del::vertex>& p_points, const del::Triangulator& p_triangulator);
+
+	// Sorts the corners of every center around it and fills the center-center
+	// and corner-corner lists. The per-element parts run on p_pool.
+	void FinishInfo(ThreadPool& p_pool);
+
+	void Clear();
+
+	static bool HasFlag(const std::vector<unsigned char>& p_flags, unsigned int i, Flag p_flag)	{ return (p_flags[i] & p_flag) != 0; }
+	static void SetFlag(std::vector<unsigned char>& p_flags, unsigned int i, Flag p_flag, bool p_value)
+	{
+		p_flags[i] = p_value ? (p_flags[i] | p_flag) : (p_flags[i] & ~p_flag);
+	}
+
+	unsigned int GetOpositeCorner(unsigned int p_edge, unsigned int p_corner) const
+	{
+		return edge_corners[2 * p_edge] == p_corner ? edge_corners[2 * p_edge + 1] : edge_corners[2 * p_edge];
+	}
+
+	// Corner at the other end of the downslope edge, the corner itself if there is none.
+	unsigned int GetDownslope(unsigned int p_corner) const
+	{
+		unsigned int e = corner_downslope_edge[p_corner];
+		return e == INVALID_INDEX ? p_corner : GetOpositeCorner(e, p_corner);
+	}
+
+	bool IsInsideBoundingBox(const Vec2& p_pos, int p_width, int p_height) const
+	{
+		return p_pos.x >= 0 && p_pos.x < p_width && p_pos.y >= 0 && p_pos.y < p_height;
+	}
+
+	// Center of the bounding box of a cell and half its diagonal.
+	std::pair<Vec2,Vec2> GetBoundingBox(unsigned int p_center) const;
+
+	// Distance of every corner to the nearest border corner, walking the
+	// corner graph: 0.01 per step, plus 1 when both ends are land. Corners
+	// that can't reach the border get 99999. Returns the number of queue
+	// pushes, every corner is settled once.
+	size_t DistanceToBorder(std::vector<double>& r_distance) const;
+
+	// Floods the corners up from the ocean in order of elevation, as the
+	// Priority-Flood of Barnes et al. Corners reached from a higher one are
+	// in a depression: they are raised to the level of the flood, a flat
+	// surface, and get the Lake flag. The downslope of every corner
+	// the flood reaches, other than the ocean, is its lowest neighbour
+	// flooded before it, so every one of them drains to the ocean. Outside
+	// the depressions that is the lowest neighbour, as before. The corners
+	// are ranked on p_pool. Returns the number of lake corners.
+	unsigned int FillDepressions(ThreadPool& p_pool);
+
+	// Runs p_iterations of stream power erosion on the land corners. Each
+	// iteration lowers every corner by its slope to its lowest neighbour
+	// times the square root of the corners draining through it, never below
+	// that neighbour, and relaxes it towards the mean of its neighbours. The
+	// water corners are the base level. An iteration only reads the heights
+	// of the last one, so the corners are updated in parallel on p_pool with
+	// the same result for any thread count; the drainage is accumulated by a
+	// single thread.
+	void Erode(unsigned int p_iterations, ThreadPool& p_pool);
+
+	// Bytes held by the arrays.
+	size_t GetMemoryUsage() const;
+
+	// Builds the pointer version with all the attributes. The nodes and their
+	// adjacency lists live in p_arena.
+	void Export(Arena& p_arena, std::vector<center *>& r_centers, std::vector<corner *>& r_corners, std::vector<edge *>& r_edges) const;
+};
@@ -0,0 +1,28 @@
+// Circumcenter
+// Circumcenter of a triangle straight from the coordinates, without the line
+// equations of the bisectors. It is taken relative to the first vertex, which
+// keeps it accurate far from the origin, and a degenerate (collinear)
+// triangle gives back its first vertex instead of dividing by zero.
+
+#pragma once
+
+#include <cstddef>
+
+inline void Circumcenter(double p_ax, double p_ay, double p_bx, double p_by, double p_cx, double p_cy,
+	double& r_x, double& r_y)
+{
+	double bx = p_bx - p_ax, by = p_by - p_ay;
+	double cx = p_cx - p_ax, cy = p_cy - p_ay;
+	double d = bx * cy - by * cx;
+	double inv = d != 0 ? 0.5 / d : 0;
+	double b2 = bx * bx + by * by;
+	double c2 = cx * cx + cy * cy;
+	r_x = p_ax + (cy * b2 - by * c2) * inv;
+	r_y = p_ay + (bx * c2 - cx * b2) * inv;
+}
+
+// Circumcenters of p_count triangles given as three vertex indices each into
+// p_coords (x, y per vertex). Writes x, y per triangle to r_centers. Several
+// triangles are done at once with SSE2 or AVX when the build targets them,
+// with the same operations as Circumcenter, so the results don't change.
+void Circumcenters(const double * p_coords, const unsigned int * p_triangles, size_t p_count, double * r_centers);
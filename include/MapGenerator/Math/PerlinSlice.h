@@ -0,0 +1,59 @@
+// PerlinSlice
+// libnoise's Perlin module on a plane of constant z, evaluated in batches.
+//
+// With z fixed, every octave of the trilinear gradient noise folds into a
+// bilinear one: each point of the x, y lattice keeps the x and y parts of its
+// gradient and, as a constant, the z part, already interpolated between the
+// two z layers around the plane. The lattice is filled once per octave from
+// libnoise's own GradientNoise3D, so the seeds, hashing and gradients are the
+// module's, and afterwards a point costs four lattice reads per octave.
+// Values are computed in float, 8 at a time with AVX2 when the processor has
+// it, and with the same operations one at a time otherwise.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Forward Declarations
+namespace noise
+{
+	namespace module
+	{
+		class Perlin;
+	}
+}
+
+class PerlinSlice
+{
+public:
+	PerlinSlice();
+
+	// Lattice of p_perlin at height p_z, covering [p_min_x, p_max_x] x
+	// [p_min_y, p_max_y]. Points outside give meaningless values.
+	void Build(const noise::module::Perlin& p_perlin, double p_z, double p_min_x, double p_min_y, double p_max_x, double p_max_y);
+
+	float GetValue(float p_x, float p_y) const;
+	void GetValues(const float * p_x, const float * p_y, size_t p_count, float * r_values) const;
+
+private:
+	struct Octave
+	{
+		float frequency;
+		float amplitude;
+		int origin_x;		// lattice coordinates of the first point
+		int origin_y;
+		int width;
+		int height;
+		size_t offset;		// of the first point in the lattice arrays
+	};
+
+	std::vector<Octave> m_octaves;
+	std::vector<float> m_gradient_x;	// already scaled like libnoise does
+	std::vector<float> m_gradient_y;
+	std::vector<float> m_constant;		// z part of the gradient noise
+	int m_quality;						// noise::NoiseQuality
+
+	// 8 values at once, only on x86-64 and when the processor has AVX2.
+	void getValuesAVX2(const float * p_x, const float * p_y, float * r_values) const;
+};
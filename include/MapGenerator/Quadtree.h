@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/Vec2.h"
+#include "Arena.h"
 #include <vector>
 #include <SFML/System.hpp>
 
@@ -54,7 +55,7 @@ class QuadTree
 public:
 
 	~QuadTree(void) {
-		if(m_divided){
+		if(m_divided && m_arena == nullptr){
 			delete m_northWest;
 			delete m_northEast;
 			delete m_southEast;
@@ -62,13 +63,31 @@ public:
 		}
 	}
 
-	QuadTree(AABB p_boundary, int p_depth) {
+	// With an arena the branches and their element lists are taken from it,
+	// and are only freed by releasing the arena (after a Clear()).
+	QuadTree(AABB p_boundary, int p_depth, Arena * p_arena = nullptr) :
+		m_elements(ArenaAllocator<T>(p_arena)), m_elements_regions(ArenaAllocator<AABB>(p_arena)), m_arena(p_arena) {
 		m_boundary = p_boundary;
 		m_divided = false;
 		m_branch_depth = p_depth;
 		m_elements_branch = 0;
 	}
 
+	// Removes every element and branch.
+	void Clear() {
+		if(m_divided && m_arena == nullptr){
+			delete m_northWest;
+			delete m_northEast;
+			delete m_southEast;
+			delete m_southWest;
+		}
+		m_northWest = m_northEast = m_southEast = m_southWest = nullptr;
+		m_divided = false;
+		m_elements_branch = 0;
+		m_elements = std::vector<T, ArenaAllocator<T> >(ArenaAllocator<T>(m_arena));
+		m_elements_regions = std::vector<AABB, ArenaAllocator<AABB> >(ArenaAllocator<AABB>(m_arena));
+	}
+
 	bool Insert(const T p_element, Vec2 p_pos){
 		// Exit if the element doesn't belong here
 		if(!m_boundary.Contains(p_pos)){
@@ -202,19 +221,19 @@ private:
 
 		Vec2 l_nw_pos = m_boundary.m_pos - l_new_half;
 		AABB l_northWest(l_nw_pos, l_new_half);
-		m_northWest = new QuadTree<T>(l_northWest, m_branch_depth + 1);
+		m_northWest = NewBranch(l_northWest);
 
 		Vec2 l_ne_pos(l_nw_pos.x + m_boundary.m_half.x, l_nw_pos.y);
 		AABB l_nothEast(l_ne_pos, l_new_half);
-		m_northEast = new QuadTree<T>(l_nothEast, m_branch_depth + 1);
+		m_northEast = NewBranch(l_nothEast);
 
 		Vec2 l_se_pos = m_boundary.m_pos + l_new_half;
 		AABB l_southEast(l_se_pos, l_new_half);
-		m_southEast = new QuadTree<T>(l_southEast, m_branch_depth + 1);
+		m_southEast = NewBranch(l_southEast);
 
 		Vec2 l_sw_pos(l_nw_pos.x, l_nw_pos.y + m_boundary.m_half.y);
 		AABB l_southWest(l_sw_pos, l_new_half);
-		m_southWest = new QuadTree<T>(l_southWest, m_branch_depth + 1);
+		m_southWest = NewBranch(l_southWest);
 
 		typename vector<pair<T, AABB> >::iterator iter;
 		for (iter = m_elements.begin(); iter != m_elements.end(); iter++){
@@ -244,23 +263,30 @@ private:
 
 		Vec2 l_nw_pos = m_boundary.m_pos - l_new_half;
 		AABB l_northWest(l_nw_pos, l_new_half);
-		m_northWest = new QuadTree<T>(l_northWest, m_branch_depth + 1);
+		m_northWest = NewBranch(l_northWest);
 
 		Vec2 l_ne_pos(l_nw_pos.x + m_boundary.m_half.x, l_nw_pos.y);
 		AABB l_nothEast(l_ne_pos, l_new_half);
-		m_northEast = new QuadTree<T>(l_nothEast, m_branch_depth + 1);
+		m_northEast = NewBranch(l_nothEast);
 
 		Vec2 l_se_pos = m_boundary.m_pos + l_new_half;
 		AABB l_southEast(l_se_pos, l_new_half);
-		m_southEast = new QuadTree<T>(l_southEast, m_branch_depth + 1);
+		m_southEast = NewBranch(l_southEast);
 
 		Vec2 l_sw_pos(l_nw_pos.x, l_nw_pos.y + m_boundary.m_half.y);
 		AABB l_southWest(l_sw_pos, l_new_half);
-		m_southWest = new QuadTree<T>(l_southWest, m_branch_depth + 1);
+		m_southWest = NewBranch(l_southWest);
+	}
+
+	QuadTree * NewBranch(const AABB& p_boundary) {
+		if(m_arena != nullptr)
+			return m_arena->New<QuadTree<T> >(p_boundary, m_branch_depth + 1, m_arena);
+		return new QuadTree<T>(p_boundary, m_branch_depth + 1);
 	}
 
-	std::vector<T> m_elements;
-	std::vector<AABB> m_elements_regions;
+	std::vector<T, ArenaAllocator<T> > m_elements;
+	std::vector<AABB, ArenaAllocator<AABB> > m_elements_regions;
+	Arena * m_arena;
 
 	QuadTree *m_northWest{nullptr};
 	QuadTree *m_northEast{nullptr};
@@ -0,0 +1,19 @@
+// RankSort
+// Stable LSD radix sort of indices by double keys, to rank them.
+//
+// The passes sort the keys rounded to float, over the bits that differ
+// between the smallest and the largest one, 13 at a time at most. Every pass
+// counts the digits of a block of indices per thread of the pool, and then
+// each block is scattered by its own thread. Runs that rounded to the same
+// float but aren't equal are then stable sorted by the doubles, so the order
+// is the one std::stable_sort gives, whatever the thread count.
+
+#pragma once
+
+#include <vector>
+
+// Forward Declarations
+class ThreadPool;
+
+// Sorts r_indices by p_keys[index], equal keys in the order they come in.
+void RankSort(const std::vector<double>& p_keys, std::vector<unsigned int>& r_indices, ThreadPool& p_pool);
@@ -0,0 +1,66 @@
+// StageGraph
+// Stages of a pipeline, declared with the data they read and write, and run
+// as a dependency graph.
+//
+// A stage depends on every stage declared before it that writes something
+// it reads or writes, or reads something it writes. Any order that respects
+// those dependencies gives the results of the declaration order, so Run
+// starts every stage as soon as the ones it depends on are done, on up to a
+// given number of threads. The critical path is the chain of dependencies
+// with the longest total time: no thread count makes a run shorter than it.
+// Every stage is a trace zone of its name.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class StageGraph
+{
+public:
+	typedef std::function<void()> StageFunction;
+	// Data read or written by a stage, one bit per piece of data.
+	typedef unsigned int DataSet;
+
+	StageGraph();
+
+	// Returns the index of the stage.
+	unsigned int Add(const std::string& p_name, DataSet p_reads, DataSet p_writes, const StageFunction& p_function);
+	void Clear();
+
+	// Runs the stages in p_targets and the ones they depend on, all of them
+	// if it is empty, on up to p_thread_count threads.
+	void Run(unsigned int p_thread_count, const std::vector<unsigned int>& p_targets);
+
+	unsigned int GetStageCount() const;
+	const std::string& GetName(unsigned int p_stage) const;
+	// Whether the last run included the stage, and its milliseconds.
+	bool WasRun(unsigned int p_stage) const;
+	double GetTime(unsigned int p_stage) const;
+	// Stages of the critical path of the last run, in order, and its time.
+	const std::vector<unsigned int>& GetCriticalPath() const;
+	double GetCriticalTime() const;
+	// Milliseconds from the start of the last run to the end of its last stage.
+	double GetWallTime() const;
+
+private:
+	struct Stage
+	{
+		std::string name;
+		DataSet reads;
+		DataSet writes;
+		StageFunction function;
+		const char * trace_name;
+		std::vector<unsigned int> dependencies;		// earlier stages
+		bool run;
+		double ms;
+	};
+
+	std::vector<Stage> m_stages;
+	std::vector<unsigned int> m_critical_path;
+	double m_critical_time;
+	double m_wall_time;
+
+	void findCriticalPath();
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/Vec2.h"
+#include "Arena.h"
 #include <vector>
 #include <list>
 
@@ -33,12 +34,16 @@ struct Biome
 struct edge;
 struct corner;
 
+// Adjacency list of a node; kept in the Map's arena when the node is.
+template <class T>
+using NodeList = std::vector<T, ArenaAllocator<T> >;
+
 // Center of Voronoi cell; Corner of Delaunay triangle
 struct center{
 	center() : index(0), position(0,0), water(false), ocean(false), coast(false),
 		border(false), biome(Biome::None), elevation(0.0), moisture(0.0) {}
 
-	center(unsigned int i, Vec2 p) : index(i), position(p), ocean(false), water(false), 
+	center(unsigned int i, Vec2 p) : index(i), position(p), water(false), ocean(false),
 		coast(false), border(false), biome(Biome::None), elevation(0.0), moisture(0.0) {}
 
 	unsigned int		index;	
@@ -52,9 +57,9 @@ struct center{
 	double elevation;
 	double moisture;
 
-	std::vector<edge *>		edges;
-	std::vector<corner *>	corners;
-	std::vector<center *>	centers;
+	NodeList<edge *>		edges;
+	NodeList<corner *>		corners;
+	NodeList<center *>		centers;
 
 	bool RemoveEdge(edge *e);
 	bool RemoveCorner(corner *c);
@@ -65,6 +70,7 @@ struct center{
 	std::pair<Vec2,Vec2> GetBoundingBox();
 	void SortCorners();
 	bool GoesBefore(Vec2 p_a, Vec2 p_b);
+	static bool GoesBefore(Vec2 p_center, Vec2 p_a, Vec2 p_b);
 
 	typedef std::vector<center *>::iterator PVIter;
 	typedef std::list<center *>::iterator PLIter;
@@ -95,30 +101,33 @@ struct edge{
 
 // Corner of Voronoi cell; Circumcenter of Delaunay triangle
 struct corner{
-	corner() : index(0), position(0,0), ocean(false), water(false), coast(false), border(false),
-		elevation(0.0), moisture(0.0), river_volume(0.0), downslope(NULL) {}
+	corner() : index(0), ocean(false), water(false), coast(false), border(false), lake(false), position(0,0),
+		elevation(0.0), moisture(0.0), river_volume(0.0), downslope(NULL), downslope_edge(NULL) {}
 
-	corner(unsigned int i, Vec2 p) : index(i), position(p), ocean(false), water(false), coast(false), border(false),
-		elevation(0.0), moisture(0.0), river_volume(0.0), downslope(NULL) {}
+	corner(unsigned int i, Vec2 p) : index(i), ocean(false), water(false), coast(false), border(false), lake(false), position(p),
+		elevation(0.0), moisture(0.0), river_volume(0.0), downslope(NULL), downslope_edge(NULL) {}
 
 	unsigned int		index;
 	bool ocean;
 	bool water;
 	bool coast;
 	bool border;
+	bool lake;		// in a depression, filled up to its outlet
 	Vec2				position;
 
 	double elevation;
 	double moisture;
 	double river_volume;
 	corner *downslope;
+	edge *downslope_edge;	// edge leading to downslope
 
-	std::vector<center *>	centers;
-	std::vector<edge *>		edges;	
-	std::vector<corner *>	corners;
+	NodeList<center *>		centers;
+	NodeList<edge *>		edges;
+	NodeList<corner *>		corners;
 
 	bool IsPointInCircumcircle(Vec2 p);
 	Vec2 CalculateCircumcenter();
+	static Vec2 Circumcenter(Vec2 a, Vec2 b, Vec2 c);
 	center * GetOpositeCenter(center *c0, center *c1);
 	void SwitchAdjacent(corner *old_corner, corner * new_corner);
 	bool TouchesCenter(center *c);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing pool for the per-element stages of a map.
+//
+// ParallelFor splits a range of indices in chunks and hands every thread,
+// the calling one included, a contiguous run of them. A thread takes chunks
+// from the front of its own run and, once it is empty, steals from the back
+// of the others', so uneven chunks still finish together. Every index is
+// visited exactly once, so a loop whose iterations don't share writes gives
+// the same result for any thread count. The workers are started on the
+// first loop after the thread count changes, and sleep in between loops. A
+// loop started from another thread while one is running, by a stage that
+// runs next to another, is run by the calling thread alone. Every thread's
+// part of a loop is a trace zone.
+class ThreadPool
+{
+public:
+	typedef std::function<void(unsigned int, unsigned int)> RangeFunction;
+
+	explicit ThreadPool(unsigned int p_thread_count = 1);
+	~ThreadPool();
+
+	void SetThreadCount(unsigned int p_thread_count);
+	unsigned int GetThreadCount() const;
+
+	// Calls p_body(begin, end) on sub-ranges of [p_begin, p_end) at most
+	// p_grain long, and returns once all of them are done. Not reentrant:
+	// p_body can't start another loop on the same pool.
+	void ParallelFor(unsigned int p_begin, unsigned int p_end, unsigned int p_grain, const RangeFunction& p_body);
+
+private:
+	// Chunks [front, back) left to a thread.
+	struct Queue
+	{
+		std::mutex mutex;
+		unsigned int front;
+		unsigned int back;
+	};
+
+	unsigned int m_thread_count;
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<Queue[]> m_queues;
+
+	std::mutex m_loop_mutex;	// held by the thread running a loop
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	unsigned long long m_generation;	// loops started so far
+	unsigned int m_busy_workers;
+	bool m_stop;
+
+	// The loop being run.
+	const RangeFunction * m_body;
+	unsigned int m_begin;
+	unsigned int m_end;
+	unsigned int m_grain;
+	unsigned int m_participants;
+
+	void startWorkers();
+	void stopWorkers();
+	void workerLoop(unsigned int p_index, unsigned long long p_generation);
+	void runChunks(unsigned int p_index);
+	bool takeChunk(unsigned int p_index, unsigned int& r_chunk);
+};
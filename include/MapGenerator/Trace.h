@@ -0,0 +1,60 @@
+// Trace
+// Timed zones of the stages and of the threads that run them, written as a
+// Chrome trace (chrome://tracing, or ui.perfetto.dev).
+//
+// A TraceZone records its name, its start and its length when it goes out
+// of scope. Every thread keeps the zones it records in a ring buffer of its
+// own, so recording takes no lock, and the oldest zones are overwritten
+// once it is full; the buffer of a thread that ended goes to the next new
+// one. While tracing is disabled, the default, a zone only reads a flag.
+// Zones are nested by time, and each buffer is a track.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class Trace
+{
+public:
+	static void SetEnabled(bool p_enabled);
+	static bool IsEnabled()	{ return s_enabled.load(std::memory_order_relaxed); }
+
+	// Names the track of the calling thread, traced or not yet. Tracks of
+	// threads never named are "Thread" and their number.
+	static void SetThreadName(const std::string& p_name);
+	// Copy of p_name that lives as long as the program, for zone names that
+	// aren't literals. The same text gives the same pointer.
+	static const char * Intern(const std::string& p_name);
+
+	// Writes the zones of every thread as trace events, in JSON. Meant to be
+	// called, as Clear, while no thread is recording.
+	static bool Write(const std::string& p_file_name);
+	static void Clear();
+	// Zones in the buffers, the overwritten ones left out.
+	static size_t GetZoneCount();
+
+	// Nanoseconds from the first call.
+	static uint64_t Now();
+	static void Record(const char * p_name, uint64_t p_start, uint64_t p_end);
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+// Records the time from its construction to its destruction, p_name must
+// outlive the trace.
+class TraceZone
+{
+public:
+	explicit TraceZone(const char * p_name) : m_name(Trace::IsEnabled() ? p_name : nullptr), m_start(m_name ? Trace::Now() : 0) {}
+	~TraceZone()	{ if (m_name) Trace::Record(m_name, m_start, Trace::Now()); }
+
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+	const char * m_name;
+	uint64_t m_start;
+};
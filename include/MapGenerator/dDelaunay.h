@@ -42,11 +42,12 @@ namespace del {
 // I designed this with GDI+ in mind. However, this particular code doesn't
 // use GDI+ at all, only some of it's variable types.
 // These definitions are substitutes for those of GDI+. 
-typedef float REAL;
+// REAL is a double here, so large worlds keep their precision.
+typedef double REAL;
 struct PointF
 {
 	PointF() : X(0), Y(0)	{}
-	PointF(const PointF& p) : X(p.X), Y(p.Y)	{}
+	PointF(const PointF& p) = default;
 	PointF(REAL x, REAL y) : X(x), Y(y)	{}
 	PointF operator+(const PointF& p) const	{ return PointF(X + p.X, Y + p.Y); }
 	PointF operator-(const PointF& p) const	{ return PointF(X - p.X, Y - p.Y); }
@@ -54,7 +55,7 @@ struct PointF
 	REAL Y;
 };
 
-const REAL REAL_EPSILON = 1.192092896e-07F;	// = 2^-23; I've no idea why this is a good value, but GDI+ has it.
+const REAL REAL_EPSILON = 1.192092896e-07;	// = 2^-23; I've no idea why this is a good value, but GDI+ has it.
 
 #endif // _GDIPLUS_H
 
@@ -65,7 +66,7 @@ class vertex
 {
 public:
 	vertex()					: m_Pnt(0.0F, 0.0F)			{}
-	vertex(const vertex& v)		: m_Pnt(v.m_Pnt)			{}
+	vertex(const vertex& v)		= default;
 	vertex(const PointF& pnt)	: m_Pnt(pnt)				{}
 	vertex(REAL x, REAL y)		: m_Pnt(x, y)				{}
 	vertex(int x, int y)		: m_Pnt((REAL) x, (REAL) y)	{}
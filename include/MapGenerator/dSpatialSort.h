@@ -0,0 +1,25 @@
+// Spatial sorting of the triangulator input.
+// The walk in del::Triangulator starts near the previously inserted points;
+// inserting in an order where consecutive points are close keeps the walks
+// short and the touched triangles in cache.
+
+#pragma once
+
+#include "dDelaunay.h"
+#include <vector>
+
+namespace del {
+
+// Reorders vertices along a Hilbert curve over their bounding box.
+void HilbertSort(std::vector<vertex>& vertices);
+
+// Biased randomized insertion order: the vertices are split in rounds of
+// doubling size, chosen at random from seed, and each round is sorted along
+// the Hilbert curve. Keeps the locality of HilbertSort while avoiding the
+// worst cases of a fully deterministic order.
+void BrioSort(std::vector<vertex>& vertices, unsigned int seed);
+
+// Position of (x, y) along a Hilbert curve of order bits (x, y < 2^bits).
+unsigned long long HilbertIndex(unsigned int x, unsigned int y, unsigned int bits);
+
+}
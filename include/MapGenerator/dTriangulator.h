@@ -0,0 +1,105 @@
+// Triangulator
+// Incremental Delaunay triangulation over flat index arrays.
+//
+// Unlike del::Delaunay, which keeps the live triangles in a multiset and
+// rebuilds an edge set for every vertex, this works on plain arrays:
+// triangle t owns the half-edges 3t, 3t+1 and 3t+2, GetTriangles()[e] is the
+// vertex the half-edge e starts at and GetHalfedges()[e] is its twin in the
+// neighbouring triangle. Points are located by walking from a triangle
+// created nearby, remembered in a coarse grid, and the Delaunay property is
+// restored with edge flips.
+//
+// Co-circular points are resolved by symbolic perturbation, so the result is
+// unique for a given input. Triangles come out in a canonical order (sorted by
+// their smallest vertex index, which goes first), which makes the output of
+// the multithreaded mode identical to the serial one.
+
+#pragma once
+
+#include "dDelaunay.h"
+#include <vector>
+#include <climits>
+
+namespace del {
+
+class Triangulator
+{
+public:
+	static const unsigned int INVALID_INDEX = UINT_MAX;
+
+	Triangulator();
+
+	// Calculate the Delaunay triangulation of vertices. The indices in the
+	// output refer to positions in vertices. Repeated vertices are skipped.
+	void Triangulate(const std::vector<vertex>& vertices);
+
+	// Drop-in replacement for Delaunay::Triangulate.
+	void Triangulate(const vertexSet& vertices, triangleSet& output);
+
+	// Number of threads used by Triangulate. With more than one, the points
+	// are split in vertical strips that are triangulated concurrently and
+	// then stitched together along the seams.
+	void SetThreadCount(unsigned int thread_count)	{ m_ThreadCount = thread_count; }
+
+	// Three vertex indices per triangle, in counter-clockwise order.
+	const std::vector<unsigned int>& GetTriangles() const	{ return m_Triangles; }
+	// Twin of every half-edge, INVALID_INDEX on the convex hull.
+	const std::vector<unsigned int>& GetHalfedges() const	{ return m_Halfedges; }
+	// x, y of the circumcenter of every triangle.
+	const std::vector<double>& GetCircumcenters() const	{ return m_Circumcenters; }
+
+	size_t GetTriangleCount() const	{ return m_Triangles.size() / 3; }
+
+	static unsigned int NextHalfedge(unsigned int e)	{ return e % 3 == 2 ? e - 2 : e + 1; }
+	static unsigned int PrevHalfedge(unsigned int e)	{ return e % 3 == 0 ? e + 2 : e - 1; }
+
+protected:
+	enum Location
+	{
+		Inside,
+		OnEdge,
+		OnVertex
+	};
+
+	std::vector<double> m_Coords;		// x, y of every vertex, the super triangle goes last
+	std::vector<unsigned int> m_Ranks;	// perturbation order of each vertex, the index if empty
+	std::vector<unsigned int> m_Triangles;
+	std::vector<unsigned int> m_Halfedges;
+	std::vector<double> m_Circumcenters;
+	std::vector<unsigned int> m_Stack;	// half-edges pending a Delaunay check
+	unsigned int m_VertexCount;
+	unsigned int m_Last;				// a half-edge of the last created triangle
+	unsigned int m_WalkState;
+	unsigned int m_ThreadCount;
+
+	// Walk start hints: the last triangle created in each grid cell, with
+	// coarser levels for the cells that haven't seen a point yet.
+	std::vector<unsigned int> m_Grid;
+	std::vector<unsigned int> m_GridLevels;	// offset of each level in m_Grid
+	unsigned int m_GridSize;
+	double m_GridMinX, m_GridMinY, m_GridScale;
+
+	void Compute();
+	void Run();
+	void RunParallel();
+	void Canonicalize();
+	void AddSuperTriangle();
+	void GridCell(unsigned int p, unsigned int& r_x, unsigned int& r_y) const;
+	unsigned int GetHint(unsigned int p) const;
+	void SetHint(unsigned int p, unsigned int e);
+	void RemoveSuperTriangle();
+
+	Location Locate(unsigned int p, unsigned int& r_edge);
+	void SplitTriangle(unsigned int t, unsigned int p);
+	void SplitEdge(unsigned int e, unsigned int p);
+	void Legalize(unsigned int a);
+
+	unsigned int AddTriangle(unsigned int i0, unsigned int i1, unsigned int i2);
+	void Link(unsigned int a, unsigned int b);
+
+	unsigned int Rank(unsigned int v) const;
+	double Orient(unsigned int a, unsigned int b, unsigned int c) const;
+	bool InCircle(unsigned int a, unsigned int b, unsigned int c, unsigned int d) const;
+};
+
+}
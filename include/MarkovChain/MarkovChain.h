@@ -3,6 +3,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include "Random/Random.h"
 
 class MarkovChain
  {
@@ -13,6 +14,9 @@ public:
 
 	void resetGenerator(const std::vector<std::string>& original_names, int order, int length);
 
+	// Stream the names are drawn from.
+	void setRandom(const Random& random);
+
 	std::string getName();
 	std::vector<std::string> getNames(int count);
 
@@ -22,6 +26,8 @@ private:
 	std::map<std::string, std::vector<char> > m_chains;
 	typedef std::map<std::string, std::vector<char>>::iterator ChainsIter;
 
+	Random m_random;
+
 	int order{0};
 	int min_name_length;
 
@@ -0,0 +1,70 @@
+// Random
+// Counter based random numbers.
+//
+// The n-th number of a stream is a hash of the stream key and n (the
+// SplitMix64 mix), so a stream is just a key and a counter: it can be copied,
+// jumped to any position with Get(n), and split into independent streams for
+// every stage or element with Split(). Two maps, or two threads working on the
+// same map, never share any state, and results don't depend on the order the
+// streams are used in.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Random
+{
+public:
+	typedef uint32_t result_type;
+
+	explicit Random(uint64_t p_key = 0) : m_key(p_key), m_counter(0) {}
+
+	// Independent stream identified by a number or a name.
+	Random Split(uint64_t p_stream) const	{ return Random(Mix(m_key ^ Mix(p_stream + GOLDEN_GAMMA))); }
+	Random Split(const std::string& p_stream) const	{ return Split(Hash(p_stream)); }
+
+	// The p_counter-th number of the stream, without moving it.
+	uint64_t Get(uint64_t p_counter) const	{ return Mix(m_key + (p_counter + 1) * GOLDEN_GAMMA); }
+
+	uint64_t Next64()	{ return Get(m_counter++); }
+	uint32_t Next()		{ return (uint32_t) (Next64() >> 32); }
+
+	// In [0, 1), with the 53 bits a double holds.
+	double NextDouble()	{ return (Next64() >> 11) * (1.0 / 9007199254740992.0); }
+
+	// In [0, p_count), by multiplying instead of the biased modulo.
+	uint32_t NextIndex(uint32_t p_count)	{ return (uint32_t) (((uint64_t) Next() * p_count) >> 32); }
+
+	uint64_t GetKey() const	{ return m_key; }
+
+	// UniformRandomBitGenerator, for the standard algorithms and distributions.
+	static constexpr result_type min()	{ return 0; }
+	static constexpr result_type max()	{ return UINT32_MAX; }
+	result_type operator()()			{ return Next(); }
+
+	// 64-bit FNV-1a with a final mix, to turn seed strings into keys.
+	static uint64_t Hash(const std::string& p_string)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : p_string)
+		{
+			hash ^= (unsigned char) c;
+			hash *= 1099511628211ull;
+		}
+		return Mix(hash);
+	}
+
+	static uint64_t Mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+private:
+	static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+	uint64_t m_key;
+	uint64_t m_counter;
+};
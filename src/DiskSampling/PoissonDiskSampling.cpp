@@ -2,95 +2,141 @@
 
 #include <cmath>
 
-PoissonDiskSampling::PoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count){
+// Position of the empty cells, far from everything but still finite when squared.
+static const float EMPTY_CELL = -1e18f;
+
+PoissonDiskSampling::PoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count, const Random& p_random){
+	m_stream		= p_random;
 	m_width			= p_width;
 	m_height		= p_height;
 	m_min_dist		= p_min_dist;
 	m_point_count	= p_point_count;
 	m_cell_size		= m_min_dist / 1.414214;
-	m_grid_width	= ceil(m_width / m_cell_size);
-	m_grid_height	= ceil(m_height / m_cell_size);
-	m_grid = std::vector<std::vector<point *> >(m_grid_width, std::vector<point *>(m_grid_height, NULL));
+	m_inv_cell_size	= 1 / m_cell_size;
+	m_grid_width	= (int) (m_width / m_cell_size) + 1 + 2 * GRID_MARGIN;
+	m_grid_height	= (int) (m_height / m_cell_size) + 1 + 2 * GRID_MARGIN;
 }
 
 std::vector<std::pair<double,double> > PoissonDiskSampling::Generate(){
+	reset();
+	addSample(point(m_random.NextIndex(m_width), m_random.NextIndex(m_height)));
+	grow(nullptr);
 
-	point first_point(rand() % m_width, rand() % m_height);
+	return m_sample;
+}
 
-	m_process.push_back(first_point);
-	m_sample.push_back(std::make_pair(first_point.x, first_point.y));
-	int first_point_x = first_point.x/m_cell_size;
-	int first_point_y = first_point.y/m_cell_size;
-	m_grid[first_point_x][first_point_y] = new point(first_point);
+std::vector<std::pair<double,double> > PoissonDiskSampling::Generate(const std::vector<std::pair<double,double> >& p_fixed,
+	const InsideFunction& p_inside){
+	reset();
+
+	// The fixed samples close enough to matter go in the grid and the active
+	// list, ahead of the new ones. Below zero the cell has to be rounded down.
+	for(const std::pair<double,double>& fixed : p_fixed){
+		int x_index = (int) floor(fixed.first * m_inv_cell_size) + GRID_MARGIN;
+		int y_index = (int) floor(fixed.second * m_inv_cell_size) + GRID_MARGIN;
+		if(x_index < 0 || y_index < 0 || x_index >= m_grid_width || y_index >= m_grid_height){
+			continue;
+		}
+		size_t cell = x_index + (size_t) y_index * m_grid_width;
+		m_grid[2 * cell]		= (float) fixed.first;
+		m_grid[2 * cell + 1]	= (float) fixed.second;
+		m_active.push_back((unsigned int) m_sample.size());
+		m_sample.push_back(fixed);
+	}
+	size_t fixed_count = m_sample.size();
 
-	while( !m_process.empty() ){
-		int new_point_index = rand() % m_process.size();
-		point new_point = m_process[new_point_index];
-		m_process.erase(m_process.begin() + new_point_index);
-		
-		for(int i = 0; i < m_point_count; i++){
-			point new_point_around = generatePointAround(new_point);
-
-			if(inRectangle(new_point_around) && !inNeighbourhood(new_point_around)){ 
-				//	cout << "Nuevo punto: (" << new_point_around.x << ", " << new_point_around.y << ")" << endl;
-				m_process.push_back(new_point_around);
-				m_sample.push_back(std::make_pair(new_point_around.x, new_point_around.y));
-				int new_point_x = new_point_around.x/m_cell_size;
-				int new_point_y = new_point_around.y/m_cell_size;
-				m_grid[new_point_x][new_point_y] = new point(new_point_around);
-			}
+	// Nothing to grow from, a random start inside the area.
+	for(int tries = 0; m_active.empty() && tries < 64; tries++){
+		point start(m_width * m_random.NextDouble(), m_height * m_random.NextDouble());
+		if(p_inside(start.x, start.y) && !inNeighbourhood(start)){
+			addSample(start);
 		}
 	}
+	grow(&p_inside);
 
-	return m_sample;	
+	return std::vector<std::pair<double,double> >(m_sample.begin() + fixed_count, m_sample.end());
 }
 
-PoissonDiskSampling::point PoissonDiskSampling::generatePointAround(point p_point){
-	double r1 = (double) rand() / RAND_MAX;
-	double r2 = (double) rand() / RAND_MAX;
+void PoissonDiskSampling::reset(){
+	m_grid.assign(2 * (size_t) m_grid_width * m_grid_height, EMPTY_CELL);
+	m_active.clear();
+	m_sample.clear();
 
-	double radius = m_min_dist * (r1 + 1);
+	// Densest packing of disks of diameter min_dist.
+	m_sample.reserve((size_t) (1.1547 * m_width * m_height / (m_min_dist * m_min_dist)) + 1);
+	m_active.reserve(m_sample.capacity() / 8);
 
-	double angle = 2 * 3.14159265 * r2;
+	m_random = m_stream;
+}
+
+void PoissonDiskSampling::grow(const InsideFunction * p_inside){
+	double step_cos = cos(2 * 3.14159265 / m_point_count), step_sin = sin(2 * 3.14159265 / m_point_count);
 
-	double new_x = p_point.x + radius * cos(angle);
-	double new_y = p_point.y + radius * sin(angle);
+	while( !m_active.empty() ){
+		unsigned int active_index = m_random.NextIndex((uint32_t) m_active.size());
+		const std::pair<double,double>& sample = m_sample[m_active[active_index]];
+		point new_point(sample.first, sample.second);
+		m_active[active_index] = m_active.back();
+		m_active.pop_back();
+
+		// The candidates are spread evenly around the sample, starting at a
+		// random angle, so only one sine and cosine are needed.
+		double angle = 2 * 3.14159265 * m_random.NextDouble();
+		double dir_x = cos(angle), dir_y = sin(angle);
+		for(int i = 0; i < m_point_count; i++){
+			point new_point_around = generatePointAround(new_point, dir_x, dir_y);
 
-	return point(new_x, new_y);
+			if(inRectangle(new_point_around) && (!p_inside || (*p_inside)(new_point_around.x, new_point_around.y))
+				&& !inNeighbourhood(new_point_around)){
+				addSample(new_point_around);
+			}
+
+			double next_x = dir_x * step_cos - dir_y * step_sin;
+			dir_y = dir_x * step_sin + dir_y * step_cos;
+			dir_x = next_x;
+		}
+	}
+}
+
+PoissonDiskSampling::point PoissonDiskSampling::generatePointAround(point p_point, double p_dir_x, double p_dir_y){
+	double r1 = m_random.NextDouble();
+
+	double radius = m_min_dist * (r1 + 1);
+
+	return point(p_point.x + radius * p_dir_x, p_point.y + radius * p_dir_y);
 }
 
 bool PoissonDiskSampling::inRectangle(point p_point){
 	return (p_point.x >= 0 && p_point.y >= 0 && p_point.x < m_width && p_point.y < m_height);
 }
 
+// A sample closer than min_dist can be up to two cells away. Empty cells are
+// far enough to never count, so the 5x5 window is checked without branches.
 bool PoissonDiskSampling::inNeighbourhood(point p_point){
-	std::vector<point *> cells = getCellsAround(p_point);
-	int size = cells.size();
-	for(int i = 0; i < size; i++){
-		if(cells[i]->distance(p_point) < m_min_dist){
-			return true;
+	float x = (float) p_point.x, y = (float) p_point.y;
+	float min_dist2 = (float) (m_min_dist * m_min_dist);
+	const float * cell = &m_grid[2 * (cellIndex(p_point) - 2 * m_grid_width - 2)];
+
+	bool found = false;
+	for(int j = 0; j < 5; j++, cell += 2 * m_grid_width){
+		for(int i = 0; i < 5; i++){
+			float dx = cell[2 * i] - x, dy = cell[2 * i + 1] - y;
+			found |= dx * dx + dy * dy < min_dist2;
 		}
 	}
-	return false;
+	return found;
 }
 
-std::vector<PoissonDiskSampling::point *> PoissonDiskSampling::getCellsAround(point p_point){
-	std::vector<point *> cells;
-	int x_index = p_point.x / m_cell_size;
-	int y_index = p_point.y / m_cell_size;
-
-	int min_x = std::max(0, x_index - 1);
-	int max_x = std::min(m_grid_width - 1, x_index + 1);
-
-	int min_y = std::max(0, y_index - 1);
-	int max_y = std::min(m_grid_height - 1, y_index + 1);
+void PoissonDiskSampling::addSample(point p_point){
+	size_t cell = cellIndex(p_point);
+	m_grid[2 * cell]		= (float) p_point.x;
+	m_grid[2 * cell + 1]	= (float) p_point.y;
+	m_active.push_back((unsigned int) m_sample.size());
+	m_sample.push_back(std::make_pair(p_point.x, p_point.y));
+}
 
-	for(int i = min_x; i <= max_x; i++){
-		for(int j = min_y; j <= max_y; j++){
-			if(m_grid[i][j] != NULL){
-				cells.push_back(m_grid[i][j]);
-			}
-		}
-	}
-	return cells;
-}
\ No newline at end of file
+size_t PoissonDiskSampling::cellIndex(point p_point){
+	int x_index = (int) (p_point.x * m_inv_cell_size) + GRID_MARGIN;
+	int y_index = (int) (p_point.y * m_inv_cell_size) + GRID_MARGIN;
+	return x_index + (size_t) y_index * m_grid_width;
+}
@@ -0,0 +1,233 @@
+#include "DiskSampling/PoissonTileSet.h"
+#include "DiskSampling/PoissonDiskSampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+// PoissonDiskSampling takes whole sizes, so the tiles are built with a min
+// distance of BUILD_SCALE and stored divided by it.
+static const int BUILD_SCALE = 1024;
+
+// Half widths of the edge strips and the corner squares, in min distances.
+// Across an edge, the insides of two tiles are 2 STRIP apart. The strips of
+// different directions are (CORNER - STRIP) * sqrt(2) apart, so they can be
+// built without seeing each other.
+static const double STRIP = 0.5;
+static const double CORNER = 1.25;
+
+static const char FILE_MAGIC[4] = { 'P', 'D', 'T', 'S' };
+static const unsigned int FILE_VERSION = 1;
+
+typedef std::vector<std::pair<double,double> > Samples;
+
+static void AddTranslated(const Samples& p_samples, double p_x, double p_y, Samples& r_samples){
+	for(const std::pair<double,double>& sample : p_samples){
+		r_samples.push_back(std::make_pair(sample.first + p_x, sample.second + p_y));
+	}
+}
+
+PoissonTileSet::PoissonTileSet(){
+	m_colours	= 0;
+	m_tile_size	= 0;
+}
+
+void PoissonTileSet::Build(int p_colours, int p_tile_size, int p_point_count, const Random& p_random){
+	m_colours	= std::max(1, p_colours);
+	m_tile_size	= (float) p_tile_size;
+	m_points.clear();
+	m_offsets.assign(1, 0);
+
+	double dist = BUILD_SCALE, size = p_tile_size * dist;
+	double strip = STRIP * dist, corner_size = CORNER * dist;
+	PoissonDiskSampling::InsideFunction everywhere = [](double, double){ return true; };
+
+	// The same square around every corner.
+	Samples corner;
+	{
+		PoissonDiskSampling pds((int) (2 * corner_size), (int) (2 * corner_size), dist, p_point_count, p_random.Split("corner"));
+		AddTranslated(pds.Generate(), -corner_size, -corner_size, corner);
+	}
+
+	// The strips from the origin along x and along y, between the corners at
+	// both ends.
+	std::vector<Samples> horizontal(m_colours), vertical(m_colours);
+	for(int c = 0; c < m_colours; c++){
+		Samples fixed;
+		AddTranslated(corner, -corner_size, strip, fixed);
+		AddTranslated(corner, size - corner_size, strip, fixed);
+		PoissonDiskSampling pds((int) (size - 2 * corner_size), (int) (2 * strip), dist, p_point_count, p_random.Split("horizontal").Split(c));
+		AddTranslated(pds.Generate(fixed, everywhere), corner_size, -strip, horizontal[c]);
+	}
+	for(int c = 0; c < m_colours; c++){
+		Samples fixed;
+		AddTranslated(corner, strip, -corner_size, fixed);
+		AddTranslated(corner, strip, size - corner_size, fixed);
+		PoissonDiskSampling pds((int) (2 * strip), (int) (size - 2 * corner_size), dist, p_point_count, p_random.Split("vertical").Split(c));
+		AddTranslated(pds.Generate(fixed, everywhere), -strip, corner_size, vertical[c]);
+	}
+
+	// Whatever is not a strip or a corner square is filled per tile.
+	PoissonDiskSampling::InsideFunction inside = [size, strip, corner_size](double x, double y){
+		double edge_x = std::min(x, size - x), edge_y = std::min(y, size - y);
+		return edge_x >= strip && edge_y >= strip && (edge_x >= corner_size || edge_y >= corner_size);
+	};
+
+	int tile_count = m_colours * m_colours * m_colours * m_colours;
+	for(int tile = 0; tile < tile_count; tile++){
+		int west = tile % m_colours, south = tile / m_colours % m_colours;
+		int east = tile / (m_colours * m_colours) % m_colours, north = tile / (m_colours * m_colours * m_colours);
+
+		Samples fixed;
+		AddTranslated(corner, 0, 0, fixed);
+		AddTranslated(corner, size, 0, fixed);
+		AddTranslated(corner, 0, size, fixed);
+		AddTranslated(corner, size, size, fixed);
+		AddTranslated(horizontal[north], 0, 0, fixed);
+		AddTranslated(horizontal[south], 0, size, fixed);
+		AddTranslated(vertical[west], 0, 0, fixed);
+		AddTranslated(vertical[east], size, 0, fixed);
+
+		PoissonDiskSampling pds((int) size, (int) size, dist, p_point_count, p_random.Split("tile").Split(tile));
+		Samples samples = pds.Generate(fixed, inside);
+
+		// Plus the part of the strips and corners that lies in the tile.
+		for(const std::pair<double,double>& sample : fixed){
+			if(sample.first >= 0 && sample.second >= 0 && sample.first < size && sample.second < size){
+				samples.push_back(sample);
+			}
+		}
+		for(const std::pair<double,double>& sample : samples){
+			m_points.push_back((float) (sample.first / dist));
+			m_points.push_back((float) (sample.second / dist));
+		}
+		m_offsets.push_back((unsigned int) (m_points.size() / 2));
+	}
+}
+
+bool PoissonTileSet::Save(const std::string& p_file_name) const{
+	std::ofstream file(p_file_name, std::ios::binary);
+	if(!file || IsEmpty()){
+		return false;
+	}
+
+	unsigned int header[3] = { FILE_VERSION, (unsigned int) m_colours, (unsigned int) m_offsets.size() };
+	file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+	file.write((const char *) header, sizeof(header));
+	file.write((const char *) &m_tile_size, sizeof(m_tile_size));
+	file.write((const char *) m_offsets.data(), m_offsets.size() * sizeof(unsigned int));
+	file.write((const char *) m_points.data(), m_points.size() * sizeof(float));
+	return (bool) file;
+}
+
+bool PoissonTileSet::Load(const std::string& p_file_name){
+	std::ifstream file(p_file_name, std::ios::binary);
+	char magic[4];
+	unsigned int header[3];
+	float tile_size;
+	if(!file.read(magic, sizeof(magic)) || !file.read((char *) header, sizeof(header)) || !file.read((char *) &tile_size, sizeof(tile_size))){
+		return false;
+	}
+
+	unsigned int colours = header[1], offset_count = header[2];
+	if(memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 || header[0] != FILE_VERSION || colours == 0 || colours > 16
+		|| offset_count != colours * colours * colours * colours + 1 || !(tile_size > 0)){
+		return false;
+	}
+
+	std::vector<unsigned int> offsets(offset_count);
+	if(!file.read((char *) offsets.data(), offsets.size() * sizeof(unsigned int)) || offsets[0] != 0
+		|| !std::is_sorted(offsets.begin(), offsets.end())){
+		return false;
+	}
+	// The samples are the rest of the file, exactly, so a corrupt count
+	// can't allocate more than the file holds.
+	std::streampos start = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remaining = file.tellg() - start;
+	file.seekg(start);
+	if(start < 0 || remaining < 0 || (uint64_t) remaining != 2 * sizeof(float) * (uint64_t) offsets.back()){
+		return false;
+	}
+
+	std::vector<float> points(2 * (size_t) offsets.back());
+	if(!file.read((char *) points.data(), points.size() * sizeof(float))){
+		return false;
+	}
+
+	m_colours	= (int) colours;
+	m_tile_size	= tile_size;
+	m_offsets.swap(offsets);
+	m_points.swap(points);
+	return true;
+}
+
+bool PoissonTileSet::IsEmpty() const{
+	return m_colours == 0;
+}
+
+int PoissonTileSet::GetTileCount() const{
+	return m_offsets.empty() ? 0 : (int) m_offsets.size() - 1;
+}
+
+double PoissonTileSet::GetTileSize() const{
+	return m_tile_size;
+}
+
+std::vector<std::pair<double,double> > PoissonTileSet::Generate(int p_width, int p_height, double p_min_dist, const Random& p_random) const{
+	std::vector<std::pair<double,double> > result;
+	if(IsEmpty()){
+		return result;
+	}
+
+	double tile_size = m_tile_size * p_min_dist;
+	int tiles_x = (int) ceil(p_width / tile_size), tiles_y = (int) ceil(p_height / tile_size);
+
+	// Colours of the edges between rows of tiles and between columns, and
+	// the tile that matches the four around every place.
+	Random horizontal = p_random.Split(0), vertical = p_random.Split(1);
+	std::vector<int> tiles((size_t) tiles_x * tiles_y);
+	size_t sample_count = 0;
+	for(int ty = 0; ty < tiles_y; ty++){
+		for(int tx = 0; tx < tiles_x; tx++){
+			int north = (int) (horizontal.Get(tx + (uint64_t) ty * tiles_x) % m_colours);
+			int south = (int) (horizontal.Get(tx + (uint64_t) (ty + 1) * tiles_x) % m_colours);
+			int west = (int) (vertical.Get(tx + (uint64_t) ty * (tiles_x + 1)) % m_colours);
+			int east = (int) (vertical.Get(tx + 1 + (uint64_t) ty * (tiles_x + 1)) % m_colours);
+			int tile = tileIndex(north, east, south, west);
+			tiles[tx + (size_t) ty * tiles_x] = tile;
+			sample_count += m_offsets[tile + 1] - m_offsets[tile];
+		}
+	}
+
+	result.reserve(sample_count);
+	for(int ty = 0; ty < tiles_y; ty++){
+		for(int tx = 0; tx < tiles_x; tx++){
+			int tile = tiles[tx + (size_t) ty * tiles_x];
+			const float * point = m_points.data() + 2 * (size_t) m_offsets[tile];
+			const float * end = m_points.data() + 2 * (size_t) m_offsets[tile + 1];
+			double x0 = tx * tile_size, y0 = ty * tile_size;
+
+			// Only the tiles on the right and bottom borders stick out.
+			if(x0 + tile_size <= p_width && y0 + tile_size <= p_height){
+				for(; point != end; point += 2){
+					result.push_back(std::make_pair(x0 + point[0] * p_min_dist, y0 + point[1] * p_min_dist));
+				}
+			}else{
+				for(; point != end; point += 2){
+					double x = x0 + point[0] * p_min_dist, y = y0 + point[1] * p_min_dist;
+					if(x < p_width && y < p_height){
+						result.push_back(std::make_pair(x, y));
+					}
+				}
+			}
+		}
+	}
+	return result;
+}
+
+int PoissonTileSet::tileIndex(int p_north, int p_east, int p_south, int p_west) const{
+	return ((p_north * m_colours + p_east) * m_colours + p_south) * m_colours + p_west;
+}
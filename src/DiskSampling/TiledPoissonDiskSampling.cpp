@@ -0,0 +1,165 @@
+#include "DiskSampling/TiledPoissonDiskSampling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// Position of the empty cells, far from everything but still finite when squared.
+static const float EMPTY_CELL = -1e18f;
+
+TiledPoissonDiskSampling::TiledPoissonDiskSampling(int p_width, int p_height, double p_min_dist, int p_point_count,
+	const Random& p_random){
+	m_width			= p_width;
+	m_height		= p_height;
+	m_min_dist		= p_min_dist;
+	m_point_count	= p_point_count;
+	m_random		= p_random;
+	m_thread_count	= 1;
+	m_cell_size		= m_min_dist / 1.414214;
+	m_inv_cell_size	= 1 / m_cell_size;
+
+	int cells_x = (int) (m_width / m_cell_size) + 1;
+	int cells_y = (int) (m_height / m_cell_size) + 1;
+	m_tiles_x		= (cells_x + TILE_CELLS - 1) / TILE_CELLS;
+	m_tiles_y		= (cells_y + TILE_CELLS - 1) / TILE_CELLS;
+	m_grid_width	= m_tiles_x * TILE_CELLS + 2 * GRID_MARGIN;
+	m_grid_height	= m_tiles_y * TILE_CELLS + 2 * GRID_MARGIN;
+}
+
+void TiledPoissonDiskSampling::SetThreadCount(unsigned int p_thread_count){
+	m_thread_count = std::max(1u, p_thread_count);
+}
+
+std::vector<std::pair<double,double> > TiledPoissonDiskSampling::Generate(){
+	m_grid.assign(2 * (size_t) m_grid_width * m_grid_height, EMPTY_CELL);
+	m_tile_samples.assign((size_t) m_tiles_x * m_tiles_y, std::vector<std::pair<double,double> >());
+
+	std::vector<int> phase_tiles;
+	for(int phase = 0; phase < 4; phase++){
+		phase_tiles.clear();
+		for(int ty = phase / 2; ty < m_tiles_y; ty += 2){
+			for(int tx = phase % 2; tx < m_tiles_x; tx += 2){
+				phase_tiles.push_back(tx + ty * m_tiles_x);
+			}
+		}
+
+		std::atomic<size_t> next(0);
+		auto worker = [&](){
+			std::vector<std::pair<double,double> > active;
+			for(size_t i = next++; i < phase_tiles.size(); i = next++){
+				fillTile(phase_tiles[i], active);
+			}
+		};
+
+		unsigned int thread_count = (unsigned int) std::min<size_t>(m_thread_count, phase_tiles.size());
+		std::vector<std::thread> threads;
+		for(unsigned int t = 1; t < thread_count; t++){
+			threads.push_back(std::thread(worker));
+		}
+		worker();
+		for(std::thread& thread : threads){
+			thread.join();
+		}
+	}
+
+	size_t sample_count = 0;
+	for(const std::vector<std::pair<double,double> >& samples : m_tile_samples){
+		sample_count += samples.size();
+	}
+	std::vector<std::pair<double,double> > result;
+	result.reserve(sample_count);
+	for(const std::vector<std::pair<double,double> >& samples : m_tile_samples){
+		result.insert(result.end(), samples.begin(), samples.end());
+	}
+	return result;
+}
+
+void TiledPoissonDiskSampling::fillTile(int p_tile, std::vector<std::pair<double,double> >& r_active){
+	int x0 = (p_tile % m_tiles_x) * TILE_CELLS, y0 = (p_tile / m_tiles_x) * TILE_CELLS;
+	int x1 = x0 + TILE_CELLS, y1 = y0 + TILE_CELLS;
+	std::vector<std::pair<double,double> >& samples = m_tile_samples[p_tile];
+	samples.reserve((size_t) (1.1547 * TILE_CELLS * TILE_CELLS * m_cell_size * m_cell_size / (m_min_dist * m_min_dist)) + 1);
+	Random random = m_random.Split(p_tile);
+
+	auto add_sample = [&](double x, double y, int cell_x, int cell_y){
+		float * cell = &m_grid[2 * ((size_t) (cell_y + GRID_MARGIN) * m_grid_width + cell_x + GRID_MARGIN)];
+		cell[0] = (float) x;
+		cell[1] = (float) y;
+		samples.push_back(std::make_pair(x, y));
+		r_active.push_back(std::make_pair(x, y));
+	};
+
+	// The samples that the finished neighbours left close enough to reach the tile.
+	r_active.clear();
+	for(int y = std::max(y0 - SEED_RING, -GRID_MARGIN); y < std::min(y1 + SEED_RING, m_grid_height - GRID_MARGIN); y++){
+		for(int x = std::max(x0 - SEED_RING, -GRID_MARGIN); x < std::min(x1 + SEED_RING, m_grid_width - GRID_MARGIN); x++){
+			const float * cell = &m_grid[2 * ((size_t) (y + GRID_MARGIN) * m_grid_width + x + GRID_MARGIN)];
+			if(cell[0] != EMPTY_CELL){
+				r_active.push_back(std::make_pair(cell[0], cell[1]));
+			}
+		}
+	}
+
+	// Without any, a random point of the part of the tile inside the area.
+	if(r_active.empty()){
+		double min_x = x0 * m_cell_size, max_x = std::min(x1 * m_cell_size, (double) m_width);
+		double min_y = y0 * m_cell_size, max_y = std::min(y1 * m_cell_size, (double) m_height);
+		double x = min_x + (max_x - min_x) * random.NextDouble();
+		double y = min_y + (max_y - min_y) * random.NextDouble();
+		int cell_x, cell_y;
+		cellOf(x, y, cell_x, cell_y);
+		if(x < m_width && y < m_height && cell_x >= x0 && cell_x < x1 && cell_y >= y0 && cell_y < y1){
+			add_sample(x, y, cell_x, cell_y);
+		}
+	}
+
+	double step_cos = cos(2 * 3.14159265 / m_point_count), step_sin = sin(2 * 3.14159265 / m_point_count);
+	while( !r_active.empty() ){
+		size_t active_index = random.NextIndex((uint32_t) r_active.size());
+		std::pair<double,double> point = r_active[active_index];
+		r_active[active_index] = r_active.back();
+		r_active.pop_back();
+
+		double angle = 2 * 3.14159265 * random.NextDouble();
+		double dir_x = cos(angle), dir_y = sin(angle);
+		for(int i = 0; i < m_point_count; i++){
+			double radius = m_min_dist * (random.NextDouble() + 1);
+			double x = point.first + radius * dir_x, y = point.second + radius * dir_y;
+
+			if(x >= 0 && y >= 0 && x < m_width && y < m_height){
+				int cell_x, cell_y;
+				cellOf(x, y, cell_x, cell_y);
+				if(cell_x >= x0 && cell_x < x1 && cell_y >= y0 && cell_y < y1 && !inNeighbourhood(x, y)){
+					add_sample(x, y, cell_x, cell_y);
+				}
+			}
+
+			double next_x = dir_x * step_cos - dir_y * step_sin;
+			dir_y = dir_x * step_sin + dir_y * step_cos;
+			dir_x = next_x;
+		}
+	}
+}
+
+bool TiledPoissonDiskSampling::inNeighbourhood(double p_x, double p_y) const{
+	int cell_x, cell_y;
+	cellOf(p_x, p_y, cell_x, cell_y);
+	float x = (float) p_x, y = (float) p_y;
+	float min_dist2 = (float) (m_min_dist * m_min_dist);
+	const float * cell = &m_grid[2 * ((size_t) (cell_y + GRID_MARGIN - 2) * m_grid_width + cell_x + GRID_MARGIN - 2)];
+
+	bool found = false;
+	for(int j = 0; j < 5; j++, cell += 2 * m_grid_width){
+		for(int i = 0; i < 5; i++){
+			float dx = cell[2 * i] - x, dy = cell[2 * i + 1] - y;
+			found |= dx * dx + dy * dy < min_dist2;
+		}
+	}
+	return found;
+}
+
+void TiledPoissonDiskSampling::cellOf(double p_x, double p_y, int& r_x, int& r_y) const{
+	r_x = (int) (p_x * m_inv_cell_size);
+	r_y = (int) (p_y * m_inv_cell_size);
+}
@@ -0,0 +1,100 @@
+#include "DiskSampling/VariablePoissonDiskSampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Position of the empty cells, far from everything but still finite when squared.
+static const float EMPTY_CELL = -1e18f;
+
+VariablePoissonDiskSampling::VariablePoissonDiskSampling(int p_width, int p_height, double p_min_dist, double p_max_dist,
+	DistanceFunction p_distance, int p_point_count, const Random& p_random){
+	m_width			= p_width;
+	m_height		= p_height;
+	m_min_dist		= p_min_dist;
+	m_max_dist		= std::max(p_min_dist, p_max_dist);
+	m_distance		= std::move(p_distance);
+	m_point_count	= p_point_count;
+	m_random		= p_random;
+	m_cell_size		= m_min_dist / 1.414214;
+	m_inv_cell_size	= 1 / m_cell_size;
+	m_grid_margin	= (int) std::ceil(m_max_dist * m_inv_cell_size);
+	m_grid_width	= (int) (m_width * m_inv_cell_size) + 1 + 2 * m_grid_margin;
+	m_grid_height	= (int) (m_height * m_inv_cell_size) + 1 + 2 * m_grid_margin;
+}
+
+std::vector<std::pair<double,double> > VariablePoissonDiskSampling::Generate(){
+	m_grid.assign(2 * (size_t) m_grid_width * m_grid_height, EMPTY_CELL);
+	m_active.clear();
+	m_sample.clear();
+	m_sample_dist.clear();
+
+	Random random = m_random;
+	double first_x = random.NextIndex(m_width), first_y = random.NextIndex(m_height);
+	addSample(first_x, first_y, std::min(std::max(m_distance(first_x, first_y), m_min_dist), m_max_dist));
+
+	double step_cos = cos(2 * 3.14159265 / m_point_count), step_sin = sin(2 * 3.14159265 / m_point_count);
+
+	while( !m_active.empty() ){
+		unsigned int active_index = random.NextIndex((uint32_t) m_active.size());
+		unsigned int sample = m_active[active_index];
+		double x = m_sample[sample].first, y = m_sample[sample].second, dist = m_sample_dist[sample];
+		m_active[active_index] = m_active.back();
+		m_active.pop_back();
+
+		// Candidates evenly spread around the sample, as in PoissonDiskSampling.
+		double angle = 2 * 3.14159265 * random.NextDouble();
+		double dir_x = cos(angle), dir_y = sin(angle);
+		for(int i = 0; i < m_point_count; i++){
+			double radius = dist * (random.NextDouble() + 1);
+			double new_x = x + radius * dir_x, new_y = y + radius * dir_y;
+
+			if(new_x >= 0 && new_y >= 0 && new_x < m_width && new_y < m_height){
+				double new_dist = std::min(std::max(m_distance(new_x, new_y), m_min_dist), m_max_dist);
+				if(!inNeighbourhood(new_x, new_y, new_dist)){
+					addSample(new_x, new_y, new_dist);
+				}
+			}
+
+			double next_x = dir_x * step_cos - dir_y * step_sin;
+			dir_y = dir_x * step_sin + dir_y * step_cos;
+			dir_x = next_x;
+		}
+	}
+
+	return m_sample;
+}
+
+// The window covers every cell that can hold a sample closer than p_dist.
+bool VariablePoissonDiskSampling::inNeighbourhood(double p_x, double p_y, double p_dist){
+	int reach = (int) std::ceil(p_dist * m_inv_cell_size);
+	float x = (float) p_x, y = (float) p_y;
+	float dist2 = (float) (p_dist * p_dist);
+	const float * cell = &m_grid[2 * (cellIndex(p_x, p_y) - reach * m_grid_width - reach)];
+
+	for(int j = -reach; j <= reach; j++, cell += 2 * m_grid_width){
+		bool found = false;
+		for(int i = 0; i <= 2 * reach; i++){
+			float dx = cell[2 * i] - x, dy = cell[2 * i + 1] - y;
+			found |= dx * dx + dy * dy < dist2;
+		}
+		if(found){
+			return true;
+		}
+	}
+	return false;
+}
+
+void VariablePoissonDiskSampling::addSample(double p_x, double p_y, double p_dist){
+	size_t cell = cellIndex(p_x, p_y);
+	m_grid[2 * cell]		= (float) p_x;
+	m_grid[2 * cell + 1]	= (float) p_y;
+	m_active.push_back((unsigned int) m_sample.size());
+	m_sample.push_back(std::make_pair(p_x, p_y));
+	m_sample_dist.push_back((float) p_dist);
+}
+
+size_t VariablePoissonDiskSampling::cellIndex(double p_x, double p_y){
+	int x_index = (int) (p_x * m_inv_cell_size) + m_grid_margin;
+	int y_index = (int) (p_y * m_inv_cell_size) + m_grid_margin;
+	return x_index + (size_t) y_index * m_grid_width;
+}
@@ -0,0 +1,47 @@
+#include "MapGenerator/Arena.h"
+#include <algorithm>
+
+// Blocks double in size up to this, so big graphs take a handful of blocks.
+static const size_t MAX_BLOCK_SIZE = 4 << 20;
+
+Arena::Arena(size_t p_block_size) : m_current(nullptr), m_left(0), m_next_block_size(p_block_size),
+	m_first_block_size(p_block_size), m_bytes_used(0)
+{
+}
+
+Arena::~Arena()
+{
+	Release();
+}
+
+void * Arena::Allocate(size_t p_size, size_t p_align)
+{
+	size_t padding = (p_align - (size_t) m_current % p_align) % p_align;
+	if (m_current == nullptr || padding + p_size > m_left)
+	{
+		size_t block_size = std::max(m_next_block_size, p_size + p_align);
+		char * block = static_cast<char *>(::operator new(block_size));
+		m_blocks.push_back(block);
+		m_current = block;
+		m_left = block_size;
+		m_next_block_size = std::min(m_next_block_size * 2, MAX_BLOCK_SIZE);
+		padding = (p_align - (size_t) m_current % p_align) % p_align;
+	}
+
+	char * result = m_current + padding;
+	m_current += padding + p_size;
+	m_left -= padding + p_size;
+	m_bytes_used += p_size;
+	return result;
+}
+
+void Arena::Release()
+{
+	for (char * block : m_blocks)
+		::operator delete(block);
+	m_blocks.clear();
+	m_current = nullptr;
+	m_left = 0;
+	m_next_block_size = m_first_block_size;
+	m_bytes_used = 0;
+}
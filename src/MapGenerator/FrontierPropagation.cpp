@@ -0,0 +1,259 @@
+#include "MapGenerator/FrontierPropagation.h"
+#include "MapGenerator/ThreadPool.h"
+
+// Words of the bitmaps per chunk of a level.
+static const unsigned int WORD_GRAIN = 64;
+// Indices per chunk of the passes that copy values in and out.
+static const unsigned int INDEX_GRAIN = 16384;
+
+// Position of the lowest set bit, p_bits must not be 0.
+static inline unsigned int LowestBit(uint64_t p_bits)
+{
+	static const unsigned char DE_BRUIJN_POSITION[64] =
+	{
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+	return DE_BRUIJN_POSITION[((p_bits & (0 - p_bits)) * 0x03f79d71b4cb0a89ull) >> 58];
+}
+
+FrontierPropagation::FrontierPropagation(ThreadPool& p_pool) : m_pool(p_pool), m_size(0), m_word_count(0), m_level_count(0), m_serial(false)
+{
+}
+
+void FrontierPropagation::Flood(const std::vector<unsigned int>& p_offsets, const std::vector<unsigned int>& p_adjacency,
+	const std::vector<unsigned int>& p_seeds, unsigned char p_through, unsigned char p_mark, std::vector<unsigned char>& r_flags)
+{
+	reset(r_flags.size(), p_seeds);
+
+	// A single thread marks the flags in place, the mark is the visited bit.
+	if (m_pool.GetThreadCount() == 1)
+	{
+		unsigned char * flags = r_flags.data();
+		for (unsigned int seed : p_seeds)
+		{
+			flags[seed] |= p_mark;
+		}
+		run([&p_offsets, &p_adjacency, p_through, p_mark, flags, this](unsigned int p_index)
+		{
+			for (unsigned int i = p_offsets[p_index]; i < p_offsets[p_index + 1]; i++)
+			{
+				unsigned int s = p_adjacency[i];
+				if ((flags[s] & (p_through | p_mark)) == p_through)
+				{
+					flags[s] |= p_mark;
+					setNext(s);
+				}
+			}
+		});
+		return;
+	}
+
+	// Seeds and marked indices count as visited.
+	m_pool.ParallelFor(0, (unsigned int) m_word_count, WORD_GRAIN, [this, &r_flags, p_mark](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int w = p_begin; w < p_end; w++)
+		{
+			uint64_t bits = m_frontier[w].load(std::memory_order_relaxed);
+			for (unsigned int b = 0; b < 64 && 64 * (size_t) w + b < m_size; b++)
+			{
+				if (r_flags[64 * (size_t) w + b] & p_mark) bits |= (uint64_t) 1 << b;
+			}
+			m_visited[w].store(bits, std::memory_order_relaxed);
+		}
+	});
+
+	const std::vector<unsigned char>& flags = r_flags;
+	run([this, &p_offsets, &p_adjacency, &flags, p_through](unsigned int p_index)
+	{
+		for (unsigned int i = p_offsets[p_index]; i < p_offsets[p_index + 1]; i++)
+		{
+			unsigned int s = p_adjacency[i];
+			if ((flags[s] & p_through) != p_through) continue;
+
+			if (claim(s)) setNext(s);
+		}
+	});
+
+	m_pool.ParallelFor(0, (unsigned int) m_size, INDEX_GRAIN, [this, &r_flags, p_mark](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int i = p_begin; i < p_end; i++)
+		{
+			if (m_visited[i / 64].load(std::memory_order_relaxed) & ((uint64_t) 1 << (i % 64))) r_flags[i] |= p_mark;
+		}
+	});
+}
+
+void FrontierPropagation::PropagateMax(const std::vector<unsigned int>& p_offsets, const std::vector<unsigned int>& p_adjacency,
+	const std::vector<unsigned int>& p_seeds, double p_factor, std::vector<double>& r_values)
+{
+	reset(r_values.size(), p_seeds);
+
+	// A single thread raises the values in place.
+	if (m_pool.GetThreadCount() == 1)
+	{
+		double * values = r_values.data();
+		run([&p_offsets, &p_adjacency, p_factor, values, this](unsigned int p_index)
+		{
+			double value = values[p_index] * p_factor;
+			for (unsigned int i = p_offsets[p_index]; i < p_offsets[p_index + 1]; i++)
+			{
+				unsigned int s = p_adjacency[i];
+				if (value > values[s])
+				{
+					values[s] = value;
+					setNext(s);
+				}
+			}
+		});
+		return;
+	}
+
+	if (!m_values) m_values.reset(new std::atomic<double>[m_size]);
+	m_pool.ParallelFor(0, (unsigned int) m_size, INDEX_GRAIN, [this, &r_values](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int i = p_begin; i < p_end; i++)
+		{
+			m_values[i].store(r_values[i], std::memory_order_relaxed);
+		}
+	});
+
+	run([this, &p_offsets, &p_adjacency, p_factor](unsigned int p_index)
+	{
+		double value = m_values[p_index].load(std::memory_order_relaxed) * p_factor;
+		for (unsigned int i = p_offsets[p_index]; i < p_offsets[p_index + 1]; i++)
+		{
+			unsigned int s = p_adjacency[i];
+			if (raise(s, value)) setNext(s);
+		}
+	});
+
+	m_pool.ParallelFor(0, (unsigned int) m_size, INDEX_GRAIN, [this, &r_values](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int i = p_begin; i < p_end; i++)
+		{
+			r_values[i] = m_values[i].load(std::memory_order_relaxed);
+		}
+	});
+}
+
+unsigned int FrontierPropagation::GetLevelCount() const
+{
+	return m_level_count;
+}
+
+void FrontierPropagation::reset(size_t p_size, const std::vector<unsigned int>& p_seeds)
+{
+	if (p_size != m_size || !m_frontier)
+	{
+		m_size = p_size;
+		m_word_count = (p_size + 63) / 64;
+		m_frontier.reset(new Word[m_word_count]);
+		m_next.reset(new Word[m_word_count]);
+		m_visited.reset(new Word[m_word_count]);
+		m_values.reset();
+	}
+	for (size_t w = 0; w < m_word_count; w++)
+	{
+		m_frontier[w].store(0, std::memory_order_relaxed);
+		m_next[w].store(0, std::memory_order_relaxed);
+	}
+	for (unsigned int seed : p_seeds)
+	{
+		m_frontier[seed / 64].fetch_or((uint64_t) 1 << (seed % 64), std::memory_order_relaxed);
+	}
+	m_level_count = 0;
+}
+
+template <typename Expand>
+void FrontierPropagation::run(const Expand& p_expand)
+{
+	// A single thread goes through a FIFO queue instead, m_next holding the
+	// indices waiting in it, and counts as a level every pass over what was
+	// queued by the previous one.
+	m_serial = m_pool.GetThreadCount() == 1;
+	if (m_serial)
+	{
+		m_queue.clear();
+		for (size_t w = 0; w < m_word_count; w++)
+		{
+			uint64_t bits = m_frontier[w].load(std::memory_order_relaxed);
+			for (; bits; bits &= bits - 1)
+			{
+				setNext((unsigned int) (64 * w + LowestBit(bits)));
+			}
+		}
+		for (size_t head = 0, level_end = 0; head < m_queue.size(); head++)
+		{
+			if (head == level_end)
+			{
+				level_end = m_queue.size();
+				m_level_count++;
+			}
+			unsigned int index = m_queue[head];
+			m_next[index / 64].store(m_next[index / 64].load(std::memory_order_relaxed) & ~((uint64_t) 1 << (index % 64)), std::memory_order_relaxed);
+			p_expand(index);
+		}
+		return;
+	}
+
+	std::atomic<bool> active(true);
+	while (active.load(std::memory_order_relaxed))
+	{
+		active.store(false, std::memory_order_relaxed);
+		m_pool.ParallelFor(0, (unsigned int) m_word_count, WORD_GRAIN, [this, &p_expand, &active](unsigned int p_begin, unsigned int p_end)
+		{
+			bool any = false;
+			for (unsigned int w = p_begin; w < p_end; w++)
+			{
+				uint64_t bits = m_frontier[w].load(std::memory_order_relaxed);
+				if (!bits) continue;
+				// Cleared on the way, so it is empty when it becomes the next one.
+				m_frontier[w].store(0, std::memory_order_relaxed);
+				any = true;
+				for (; bits; bits &= bits - 1)
+				{
+					p_expand(64 * w + LowestBit(bits));
+				}
+			}
+			if (any) active.store(true, std::memory_order_relaxed);
+		});
+		m_frontier.swap(m_next);
+		m_level_count++;
+	}
+	// The last level found nothing to expand.
+	m_level_count--;
+}
+
+bool FrontierPropagation::claim(unsigned int p_index)
+{
+	uint64_t bit = (uint64_t) 1 << (p_index % 64);
+	if (m_visited[p_index / 64].load(std::memory_order_relaxed) & bit) return false;
+	return !(m_visited[p_index / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
+}
+
+bool FrontierPropagation::raise(unsigned int p_index, double p_value)
+{
+	double current = m_values[p_index].load(std::memory_order_relaxed);
+	while (p_value > current)
+	{
+		if (m_values[p_index].compare_exchange_weak(current, p_value, std::memory_order_relaxed)) return true;
+	}
+	return false;
+}
+
+bool FrontierPropagation::setNext(unsigned int p_index)
+{
+	uint64_t bit = (uint64_t) 1 << (p_index % 64);
+	if (m_serial)
+	{
+		uint64_t word = m_next[p_index / 64].load(std::memory_order_relaxed);
+		if (word & bit) return false;
+		m_next[p_index / 64].store(word | bit, std::memory_order_relaxed);
+		m_queue.push_back(p_index);
+		return true;
+	}
+	return !(m_next[p_index / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
+}
@@ -1,11 +1,19 @@
 #include "MapGenerator/Map.h"
 #include "MapGenerator/Math/Vec2.h"
+#include "MapGenerator/dTriangulator.h"
+#include "MapGenerator/dSpatialSort.h"
+#include "MapGenerator/RankSort.h"
+#include "MapGenerator/Trace.h"
 #include "DiskSampling/PoissonDiskSampling.h"
+#include "DiskSampling/PoissonTileSet.h"
+#include "DiskSampling/TiledPoissonDiskSampling.h"
+#include "DiskSampling/VariablePoissonDiskSampling.h"
 #include "noise/noise.h"
 #include <ctime>
 #include <queue>
-#include <SFML/System.hpp>
 #include <climits>
+#include <algorithm>
+#include <thread>
 
 const std::vector<std::vector<Biome::Type> > Map::elevation_moisture_matrix = Map::MakeBiomeMatrix();
 
@@ -57,621 +65,677 @@ std::vector<std::vector<Biome::Type> > Map::MakeBiomeMatrix(){
 	return matrix;
 }
 
-Map::Map(int width, int height, double point_spread, std::string seed) : m_centers_quadtree(AABB(Vec2(width/2,height/2),Vec2(width/2,height/2)), 1)
+Map::Map(int width, int height, double point_spread, std::string seed) : m_propagation(m_thread_pool), m_centers_quadtree(AABB(Vec2(width/2,height/2),Vec2(width/2,height/2)), 1, &m_quadtree_arena)
 {
 	map_width = width;
 	map_height = height;
 	m_point_spread = point_spread;
-
-	double l_aprox_point_count = (2 * map_width * map_height) / (3.1416 * point_spread * point_spread);
+	m_coarse_spread = 4 * point_spread;
+	m_insertion_order = InsertionOrder::Hilbert;
+	m_point_sampler = PointSampler::Serial;
+	m_river_model = RiverModel::RandomSources;
+	m_erosion_iterations = 0;
+	m_tile_set = nullptr;
+	m_thread_count = std::max(1u, std::thread::hardware_concurrency());
+	m_thread_pool.SetThreadCount(m_thread_count);
+	m_pointer_graph_ready = false;
+
+	double l_aprox_point_count = (2.0 * map_width * map_height) / (3.1416 * point_spread * point_spread);
 	int l_max_tree_depth = floor((log(l_aprox_point_count) / log(4)) + 0.5);
-	CenterPointerQT::SetMaxDepth(l_max_tree_depth);
+	CenterIndexQT::SetMaxDepth(l_max_tree_depth);
 
 	m_seed = std::move(seed) != "" ? std::move(seed) : CreateSeed(20);
-	srand(HashString(m_seed));
+	m_random = Random(Random::Hash(m_seed));
 
-	z_coord = rand();
-	std::cout << "Seed: " << m_seed << "(" << HashString(m_seed) << ")" << std::endl;
+	z_coord = m_random.Split("noise").NextIndex(INT_MAX);
 }
 
-void Map::Generate()
+Map::~Map()
 {
-	sf::Clock timer;
-
-	GeneratePolygons();
-
-	std::cout << "Land distribution: ";
-	timer.restart();
-	GenerateLand();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
+	// Everything is owned by members; the graph nodes and the quadtree
+	// branches go away with their arenas.
+}
 
-	// ELEVATION
-	std::cout << "Coast assignment: ";
-	timer.restart();
-	AssignOceanCoastLand();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Corner altitude: ";
-	timer.restart();
-	AssignCornerElevation();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Altitude redistribution: ";
-	timer.restart();
-	RedistributeElevations();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Center altitude: ";
-	timer.restart();
-	AssignPolygonElevations();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
+// What the stages read and write, for the order they run in.
+struct MapData
+{
+	enum Type
+	{
+		Points = 1 << 0,
+		Graph = 1 << 1,				// elements, positions and adjacency
+		Flags = 1 << 2,
+		CornerElevation = 1 << 3,
+		CenterElevation = 1 << 4,
+		Downslopes = 1 << 5,
+		Rivers = 1 << 6,
+		CornerMoisture = 1 << 7,
+		CenterMoisture = 1 << 8,
+		Biomes = 1 << 9,
+		Quadtree = 1 << 10
+	};
+};
+
+void Map::Generate(unsigned int p_stages)
+{
+	TraceZone zone("Generate");
+	DeclareStages();
 
-	// MOISTURE
-	std::cout << "Downslopes: ";
-	timer.restart();
-	CalculateDownslopes();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "River generation: ";
-	timer.restart();
-	GenerateRivers();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Corner moisture: ";
-	timer.restart();
-	AssignCornerMoisture();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Moisture redistribution: ";
-	timer.restart();
-	RedistributeMoisture();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Center moisture: ";
-	timer.restart();
-	AssignPolygonMoisture();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
+	std::vector<unsigned int> targets;
+	for (unsigned int s = 0; s < m_stages.GetStageCount(); s++)
+	{
+		if (p_stages & m_stage_masks[s]) targets.push_back(s);
+	}
+	if (targets.empty()) return;
+	m_stages.Run(m_thread_count, targets);
 
-	// BIOMES
-	std::cout << "Biome assignment: ";
-	timer.restart();
-	AssignBiomes();
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
-
-	std::cout << "Populate Quadtree: ";
-	timer.restart();
-	for (int i = 0; i < centers.size(); i++)
+	m_stage_times.clear();
+	for (unsigned int s = 0; s < m_stages.GetStageCount(); s++)
 	{
-		std::pair<Vec2,Vec2> aabb(centers[i]->GetBoundingBox());
-		m_centers_quadtree.Insert2(centers[i], AABB(aabb.first, aabb.second));
+		if (!m_stages.WasRun(s)) continue;
+		m_stage_times.push_back(std::make_pair(m_stages.GetName(s), m_stages.GetTime(s)));
 	}
-	std::cout << timer.getElapsedTime().asMicroseconds() / 1000.0 << " ms." << std::endl;
+
+	m_critical_path.clear();
+	for (unsigned int s : m_stages.GetCriticalPath())
+		m_critical_path.push_back(m_stages.GetName(s));
 }
 
 void Map::GeneratePolygons()
 {
-	sf::Clock timer;
-	GeneratePoints();
-	std::cout << "Point placement: " << timer.getElapsedTime().asMicroseconds() / 1000.0 << "ms." << std::endl;
-	timer.restart();
-	Triangulate(points);
-	std::cout << "Triangulation: " << timer.getElapsedTime().asMicroseconds() / 1000.0 << "ms." << std::endl;
-	timer.restart();
-	FinishInfo();
-	std::cout << "Finishing touches: " << timer.getElapsedTime().asMicroseconds() / 1000.0 << "ms." << std::endl;
+	Generate(MapStage::Polygons);
+}
+
+void Map::DeclareStages()
+{
+	m_stages.Clear();
+	m_stage_masks.clear();
+	// The reads include the data a stage updates in place: a stage depends
+	// on every earlier one that touches what it reads, so a missing read is
+	// only safe as long as a write covers it.
+	auto add = [this](MapStage::Type p_stage, const char * p_name, unsigned int p_reads, unsigned int p_writes, const StageGraph::StageFunction& p_function)
+	{
+		m_stages.Add(p_name, p_reads, p_writes, p_function);
+		m_stage_masks.push_back(p_stage);
+	};
+
+	add(MapStage::PointPlacement, "Point placement", 0, MapData::Points, [this] { GeneratePoints(); });
+	add(MapStage::Triangulation, "Triangulation", MapData::Points, MapData::Graph, [this] { Triangulate(points); });
+	add(MapStage::FinishingTouches, "Finishing touches", MapData::Graph, MapData::Graph, [this] { FinishInfo(); });
+
+	add(MapStage::LandDistribution, "Land distribution", MapData::Graph | MapData::Flags, MapData::Flags, [this] { GenerateLand(); });
+
+	// ELEVATION
+	add(MapStage::CoastAssignment, "Coast assignment", MapData::Graph | MapData::Flags, MapData::Flags, [this] { AssignOceanCoastLand(); });
+	add(MapStage::CornerAltitude, "Corner altitude", MapData::Graph | MapData::Flags, MapData::CornerElevation, [this] { AssignCornerElevation(); });
+	add(MapStage::AltitudeRedistribution, "Altitude redistribution", MapData::Flags | MapData::CornerElevation, MapData::CornerElevation, [this] { RedistributeElevations(); });
+	if(m_erosion_iterations > 0)
+		add(MapStage::Erosion, "Erosion", MapData::Graph | MapData::Flags | MapData::CornerElevation, MapData::CornerElevation, [this] { ErodeElevations(); });
+	// The depressions are filled and get the Lake flag here, so the centers
+	// average the filled corners.
+	add(MapStage::Downslopes, "Downslopes", MapData::Graph | MapData::Flags | MapData::CornerElevation, MapData::CornerElevation | MapData::Downslopes | MapData::Flags, [this] { CalculateDownslopes(); });
+	add(MapStage::CenterAltitude, "Center altitude", MapData::Graph | MapData::CornerElevation, MapData::CenterElevation, [this] { AssignPolygonElevations(); });
+
+	// MOISTURE
+	add(MapStage::RiverGeneration, "River generation", MapData::Graph | MapData::Flags | MapData::CornerElevation | MapData::Downslopes | MapData::Rivers, MapData::Rivers, [this] { GenerateRivers(); });
+	add(MapStage::CornerMoisture, "Corner moisture", MapData::Graph | MapData::Flags | MapData::Rivers, MapData::CornerMoisture, [this] { AssignCornerMoisture(); });
+	add(MapStage::MoistureRedistribution, "Moisture redistribution", MapData::Flags | MapData::CornerMoisture, MapData::CornerMoisture, [this] { RedistributeMoisture(); });
+	add(MapStage::CenterMoisture, "Center moisture", MapData::Graph | MapData::Flags | MapData::CornerMoisture, MapData::CornerMoisture | MapData::CenterMoisture, [this] { AssignPolygonMoisture(); });
+
+	// BIOMES
+	add(MapStage::BiomeAssignment, "Biome assignment", MapData::Flags | MapData::CenterElevation | MapData::CenterMoisture, MapData::Biomes, [this] { AssignBiomes(); });
+
+	add(MapStage::Quadtree, "Populate Quadtree", MapData::Graph, MapData::Quadtree, [this] { PopulateQuadtree(); });
 }
 
 void Map::GenerateLand()
 {
-	noiseMap = new noise::module::Perlin();	
+	ResetLandNoise();
 
-	// Establezco los bordes del mapa
-	for(corner * c : corners)
+	std::vector<float> margins(m_graph.corner_count);
+	m_thread_pool.ParallelFor(0, m_graph.corner_count, 4096, [this, &margins](unsigned int p_begin, unsigned int p_end)
 	{
-		if(!c->IsInsideBoundingBox(map_width, map_height)){
-			c->border = true;
-			c->ocean = true;
-			c->water = true;
+		// Establezco los bordes del mapa
+		for (unsigned int q = p_begin; q < p_end; q++)
+		{
+			if(!m_graph.IsInsideBoundingBox(m_graph.corner_position[q], map_width, map_height)){
+				m_graph.corner_flags[q] |= MapGraph::Border | MapGraph::Ocean | MapGraph::Water;
+			}
 		}
-	}
 
-	// Determino lo que es agua y lo que es tierra
-	for (corner * c : corners)
-	{
-		c->water = !IsIsland(c->position);
-	}
+		// Determino lo que es agua y lo que es tierra
+		IslandMargins(&m_graph.corner_position[p_begin], p_end - p_begin, &margins[p_begin]);
+		for (unsigned int q = p_begin; q < p_end; q++)
+		{
+			MapGraph::SetFlag(m_graph.corner_flags, q, MapGraph::Water, !(margins[q] >= 0));
+		}
+	});
 }
 
 void Map::AssignOceanCoastLand()
 {
-	std::queue<center *> centers_queue;
+	std::vector<unsigned char>& center_flags = m_graph.center_flags;
+	std::vector<unsigned char>& corner_flags = m_graph.corner_flags;
+
+	std::vector<unsigned int> ocean_seeds;
 	// Quien es agua o border
-	for (center * c : centers)
+	for (unsigned int c = 0; c < m_graph.center_count; c++)
 	{
 		int adjacent_water = 0;
-		for (corner * q : c->corners)
+		bool border = false;
+		unsigned int begin = m_graph.center_corners_offset[c], end = m_graph.center_corners_offset[c + 1];
+		for (unsigned int i = begin; i < end; i++)
 		{
-			if(q->border)
+			unsigned int q = m_graph.center_corners[i];
+			if(corner_flags[q] & MapGraph::Border)
 			{
-				c->border = true;
-				c->ocean = true;
-				q->water = true;
-				centers_queue.push(c);
+				center_flags[c] |= MapGraph::Border | MapGraph::Ocean;
+				corner_flags[q] |= MapGraph::Water;
+				border = true;
 			}
-			if(q->water)
+			if(corner_flags[q] & MapGraph::Water)
 			{
 				adjacent_water++;
 			}
 		}
-		c->water = (c->ocean || adjacent_water >= c->corners.size() * 0.5);
-	}
-
-	// Quien es oceano y quien no
-	while(!centers_queue.empty())
-	{
-		center * c = centers_queue.front();
-		centers_queue.pop();
-		for (center * r : c->centers)
+		if(border)
 		{
-			if(r->water && !r->ocean)
-			{
-				r->ocean = true;
-				centers_queue.push(r);
-			}
+			ocean_seeds.push_back(c);
 		}
+		bool water = (center_flags[c] & MapGraph::Ocean) || adjacent_water >= (end - begin) * 0.5;
+		MapGraph::SetFlag(center_flags, c, MapGraph::Water, water);
 	}
 
+	// Quien es oceano y quien no
+	m_propagation.Flood(m_graph.center_centers_offset, m_graph.center_centers, ocean_seeds, MapGraph::Water, MapGraph::Ocean, center_flags);
+
 	// Costas de center
-	for (center * p : centers)
+	for (unsigned int p = 0; p < m_graph.center_count; p++)
 	{
 		int num_ocean = 0;
 		int num_land = 0;
-		for (center * q : p->centers)
+		for (unsigned int i = m_graph.center_centers_offset[p]; i < m_graph.center_centers_offset[p + 1]; i++)
 		{
-			num_ocean += q->ocean;
-			num_land += !q->water;
+			unsigned int q = m_graph.center_centers[i];
+			num_ocean += (center_flags[q] & MapGraph::Ocean) != 0;
+			num_land += (center_flags[q] & MapGraph::Water) == 0;
 		}
-		p->coast = num_land > 0 && num_ocean > 0;
+		MapGraph::SetFlag(center_flags, p, MapGraph::Coast, num_land > 0 && num_ocean > 0);
 	}
 
 	// Costas de corner
-	for (corner * c : corners) 
+	for (unsigned int c = 0; c < m_graph.corner_count; c++)
 	{
 		int adj_ocean = 0;
 		int adj_land = 0;
-		for (center * p : c->centers) {
-			adj_ocean += (int) p->ocean;
-			adj_land += (int) !p->water;
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int p = m_graph.corner_centers[3 * c + k];
+			adj_ocean += (center_flags[p] & MapGraph::Ocean) != 0;
+			adj_land += (center_flags[p] & MapGraph::Water) == 0;
 		}
-		c->ocean = adj_ocean == c->centers.size();
-		c->coast = adj_land > 0 && adj_ocean > 0;
-		c->water = c->border || (adj_land != c->centers.size() && !c->coast);
+		bool coast = adj_land > 0 && adj_ocean > 0;
+		MapGraph::SetFlag(corner_flags, c, MapGraph::Ocean, adj_ocean == 3);
+		MapGraph::SetFlag(corner_flags, c, MapGraph::Coast, coast);
+		MapGraph::SetFlag(corner_flags, c, MapGraph::Water, (corner_flags[c] & MapGraph::Border) || (adj_land != 3 && !coast));
 	}
 }
 
 void Map::AssignCornerElevation()
 {
-	std::queue<corner *> corner_queue;
-	for (corner * q : corners)
-	{
-		if(q->border)
-		{
-			q->elevation = 0.0;
-			corner_queue.push(q);
-		}else
-		{
-			q->elevation = 99999;
-		}
-	}
+	std::vector<double>& elevation = m_graph.corner_elevation;
+	const std::vector<unsigned char>& flags = m_graph.corner_flags;
 
-	while(!corner_queue.empty())
-	{
-		corner * q = corner_queue.front();
-		corner_queue.pop();
-
-		for (corner * s : q->corners)
-		{
-			double new_elevation = q->elevation + 0.01;
-			if(!q->water && !s->water)
-			{
-				new_elevation += 1;
-			}
-			if(new_elevation < s->elevation)
-			{
-				s->elevation = new_elevation;
-				corner_queue.push(s);
-			}
-		}
-	}
+	m_graph.DistanceToBorder(elevation);
 
-	for (corner * q : corners)
+	for (unsigned int q = 0; q < m_graph.corner_count; q++)
 	{
-		if(q->water)
+		if(flags[q] & MapGraph::Water)
 		{
-			q->elevation = 0.0;
+			elevation[q] = 0.0;
 		}
 	}
 }
 
 void Map::RedistributeElevations()
 {
-	std::vector<corner *> locations = GetLandCorners();
 	double SCALE_FACTOR = 1.05;
-
-	std::sort(locations.begin(), locations.end(), &corner::SortByElevation);
-
-	for(int i = 0; i < locations.size(); i++)
+	RedistributeByRank(m_graph.corner_elevation, [SCALE_FACTOR](double y)
 	{
-		double y = (double) i / (locations.size() - 1);
 		double x = sqrt(SCALE_FACTOR) - sqrt(SCALE_FACTOR * (1-y));
-		x = std::min(x, 1.0);
-		locations[i]->elevation = x;
-	}
+		return std::min(x, 1.0);
+	});
+}
+
+void Map::ErodeElevations()
+{
+	m_graph.Erode(m_erosion_iterations, m_thread_pool);
 }
 
 void Map::AssignPolygonElevations()
 {
-	for  (center * p : centers)
+	m_thread_pool.ParallelFor(0, m_graph.center_count, 4096, [this](unsigned int p_begin, unsigned int p_end)
 	{
-		double elevation_sum = 0.0;
-		for  (corner * q : p->corners)
+		for (unsigned int p = p_begin; p < p_end; p++)
 		{
-			elevation_sum += q->elevation;
+			double elevation_sum = 0.0;
+			unsigned int begin = m_graph.center_corners_offset[p], end = m_graph.center_corners_offset[p + 1];
+			for (unsigned int i = begin; i < end; i++)
+			{
+				elevation_sum += m_graph.corner_elevation[m_graph.center_corners[i]];
+			}
+			m_graph.center_elevation[p] = elevation_sum / (end - begin);
 		}
-		p->elevation = elevation_sum / p->corners.size();
-	}
+	});
 }
 
 void Map::CalculateDownslopes()
 {
-	for (corner * c : corners)
+	const std::vector<double>& elevation = m_graph.corner_elevation;
+	m_thread_pool.ParallelFor(0, m_graph.corner_count, 8192, [this, &elevation](unsigned int p_begin, unsigned int p_end)
 	{
-		corner * d = c;
-		for (corner * q : c->corners)
+		for (unsigned int c = p_begin; c < p_end; c++)
 		{
-			if(q->elevation < d->elevation)
+			unsigned int d = c;
+			unsigned int d_edge = MapGraph::INVALID_INDEX;
+			for (unsigned int k = 0; k < 3; k++)
 			{
-				d = q;
+				unsigned int e = m_graph.corner_edges[3 * c + k];
+				unsigned int q = m_graph.GetOpositeCorner(e, c);
+				if(q != MapGraph::INVALID_INDEX && elevation[q] < elevation[d])
+				{
+					d = q;
+					d_edge = e;
+				}
 			}
+			m_graph.corner_downslope_edge[c] = d_edge;
 		}
-		c->downslope = d;
-	}
+	});
+
+	// Depressions would end the rivers inland, they are filled up to their
+	// outlet and drained through it.
+	m_graph.FillDepressions(m_thread_pool);
 }
 
+// The water of every source follows the downslopes until it reaches the
+// coast or a corner without a downslope. The downslopes always go down, so
+// they make a forest, and the water is accumulated over it in one pass from
+// the corners nothing flows into.
 void Map::GenerateRivers()
 {
+	const std::vector<unsigned char>& flags = m_graph.corner_flags;
+	const std::vector<double>& elevation = m_graph.corner_elevation;
+	auto can_start = [&flags, &elevation](unsigned int q)
+	{
+		return !(flags[q] & MapGraph::Ocean) && elevation[q] >= 0.3 && elevation[q] <= 0.9;
+	};
+	auto flows_on = [this, &flags](unsigned int q)
+	{
+		return !(flags[q] & MapGraph::Coast) && m_graph.corner_downslope_edge[q] != MapGraph::INVALID_INDEX;
+	};
+
 	//int num_rios = (map_height + map_width) / 4;
-	int num_rios = centers.size() / 3;
-	for(int i = 0; i < num_rios; i++){
-		corner *q = corners[rand()%corners.size()];
-		if( q->ocean || q->elevation < 0.3 || q->elevation > 0.9 ) continue;
+	int num_rios = m_graph.center_count / 3;
+	std::vector<double> flow(m_graph.corner_count, 0.0);
+	if(m_river_model == RiverModel::Drainage){
+		double share = (double) num_rios / m_graph.corner_count;
+		for (unsigned int q = 0; q < m_graph.corner_count; q++)
+			if(can_start(q)) flow[q] = share;
+	}else{
+		Random rivers = m_random.Split("rivers");
+		for(int i = 0; i < num_rios; i++){
+			unsigned int q = rivers.Split(i).NextIndex(m_graph.corner_count);
+			if(can_start(q)) flow[q] += 1;
+		}
+	}
+
+	// Corners that still have to pass their water to each one
+	std::vector<unsigned int> upstream(m_graph.corner_count, 0);
+	for (unsigned int q = 0; q < m_graph.corner_count; q++)
+		if(flows_on(q)) upstream[m_graph.GetDownslope(q)]++;
 
-		while(!q->coast)
+	std::vector<unsigned int> ready;
+	ready.reserve(m_graph.corner_count);
+	for (unsigned int q = 0; q < m_graph.corner_count; q++)
+		if(upstream[q] == 0) ready.push_back(q);
+
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		unsigned int q = ready[i];
+		if(!flows_on(q)) continue;
+
+		unsigned int downslope = m_graph.GetDownslope(q);
+		if(flow[q] > 0)
 		{
-			if(q == q->downslope)
-			{
-				break;
-			}
-			edge * e = q->GetEdgeWith(q->downslope);
-			e->river_volume += 1;
-			q->river_volume += 1;
-			q->downslope->river_volume += 1;
-			q = q->downslope;
+			m_graph.edge_river_volume[m_graph.corner_downslope_edge[q]] += flow[q];
+			m_graph.corner_river_volume[q] += flow[q];
+			m_graph.corner_river_volume[downslope] += flow[q];
+			flow[downslope] += flow[q];
 		}
+		if(--upstream[downslope] == 0) ready.push_back(downslope);
 	}
 }
 
 void Map::AssignCornerMoisture()
 {
-	std::queue<corner *> corner_queue;
+	std::vector<double>& moisture = m_graph.corner_moisture;
+	const std::vector<unsigned char>& flags = m_graph.corner_flags;
+	const std::vector<double>& river_volume = m_graph.corner_river_volume;
+
 	// Agua dulce
-	for (corner * c : corners) {
-		if((c->water || c->river_volume > 0) && !c->ocean){
-			c->moisture = c->river_volume > 0 ? std::min(3.0, (0.2 * c->river_volume)) : 1.0;
-			corner_queue.push(c);
+	std::vector<unsigned int> seeds;
+	for (unsigned int c = 0; c < m_graph.corner_count; c++) {
+		if(((flags[c] & (MapGraph::Water | MapGraph::Lake)) || river_volume[c] > 0) && !(flags[c] & MapGraph::Ocean)){
+			moisture[c] = river_volume[c] > 0 ? std::min(3.0, (0.2 * river_volume[c])) : 1.0;
+			seeds.push_back(c);
 		}else{
-			c->moisture = 0.0;
-		}
-	}
-
-	while(!corner_queue.empty()){
-		corner * c = corner_queue.front();
-		corner_queue.pop();
-
-		for (corner * r : c->corners)	{
-			double new_moisture = c->moisture * 0.9;
-			if( new_moisture > r->moisture ){
-				r->moisture = new_moisture;
-				corner_queue.push(r);
-			}
+			moisture[c] = 0.0;
 		}
 	}
+	m_propagation.PropagateMax(m_graph.corner_corners_offset, m_graph.corner_corners, seeds, 0.9, moisture);
 
 	// Agua salada
-	for (corner * r : corners) {
-		if(r->ocean){
-			r->moisture = 1.0;
-			corner_queue.push(r);
+	seeds.clear();
+	for (unsigned int r = 0; r < m_graph.corner_count; r++) {
+		if(flags[r] & MapGraph::Ocean){
+			moisture[r] = 1.0;
+			seeds.push_back(r);
 		}
 	}
-	while(!corner_queue.empty()){
-		corner * c = corner_queue.front();
-		corner_queue.pop();
-
-		for (corner * r : c->corners)	{
-			double new_moisture = c->moisture * 0.3;
-			if( new_moisture > r->moisture ){
-				r->moisture = new_moisture;
-				corner_queue.push(r);
-			}
-		}
-	}
-
+	m_propagation.PropagateMax(m_graph.corner_corners_offset, m_graph.corner_corners, seeds, 0.3, moisture);
 }
 
 void Map::RedistributeMoisture(){
-	std::vector<corner *> locations = GetLandCorners();
+	RedistributeByRank(m_graph.corner_moisture, [](double y) { return y; });
+}
 
-	std::sort(locations.begin(), locations.end(), &corner::SortByMoisture);
+// Every land corner gets p_curve of its rank among them, scaled to [0, 1].
+// Equal values are ranked by corner index. A single land corner is the
+// lowest rank, 0.
+void Map::RedistributeByRank(std::vector<double>& r_values, const std::function<double(double)>& p_curve)
+{
+	std::vector<unsigned int> locations = GetLandCorners();
+	RankSort(r_values, locations, m_thread_pool);
 
-	for(int i = 0; i < locations.size(); i++){
-		locations[i]->moisture = (double) i / (locations.size() - 1);
+	unsigned int count = (unsigned int) locations.size();
+	if (count <= 1)
+	{
+		if (count == 1) r_values[locations[0]] = p_curve(0.0);
+		return;
 	}
+	m_thread_pool.ParallelFor(0, count, 16384, [&r_values, &p_curve, &locations, count](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int i = p_begin; i < p_end; i++)
+		{
+			r_values[locations[i]] = p_curve((double) i / (count - 1));
+		}
+	});
 }
 
 void Map::AssignPolygonMoisture(){
-	for (center * p : centers) {
-		double new_moisture = 0.0;
-		for (corner * q : p->corners){
-			if(q->moisture > 1.0) q->moisture = 1.0;
-			new_moisture += q->moisture;
+	// The corners are clamped on their own first, a corner is shared by
+	// several centers.
+	std::vector<double>& corner_moisture = m_graph.corner_moisture;
+	m_thread_pool.ParallelFor(0, m_graph.corner_count, 8192, [&corner_moisture](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int q = p_begin; q < p_end; q++){
+			if(corner_moisture[q] > 1.0) corner_moisture[q] = 1.0;
 		}
-		p->moisture = new_moisture / p->corners.size();
-	}
+	});
+
+	m_thread_pool.ParallelFor(0, m_graph.center_count, 4096, [this, &corner_moisture](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int p = p_begin; p < p_end; p++) {
+			double new_moisture = 0.0;
+			unsigned int begin = m_graph.center_corners_offset[p], end = m_graph.center_corners_offset[p + 1];
+			for (unsigned int i = begin; i < end; i++){
+				new_moisture += corner_moisture[m_graph.center_corners[i]];
+			}
+			m_graph.center_moisture[p] = new_moisture / (end - begin);
+		}
+	});
 }
 
 void Map::AssignBiomes(){
 
-	for (center * c : centers) {
-		if(c->ocean){
-			c->biome = Biome::Ocean;
-		}else if(c->water){
-			c->biome = Biome::Lake;
-		}else if(c->coast && c->moisture < 0.6){
-			c->biome = Biome::Beach;
-		}else{
-			int elevation_index = 0;
-			if(c->elevation > 0.85){
-				elevation_index = 3;
-			}else if(c->elevation > 0.6){
-				elevation_index = 2;
-			}else if(elevation_index > 0.3){
-				elevation_index = 1;
+	m_thread_pool.ParallelFor(0, m_graph.center_count, 4096, [this](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int c = p_begin; c < p_end; c++) {
+			unsigned char flags = m_graph.center_flags[c];
+			double moisture = m_graph.center_moisture[c];
+			if(flags & MapGraph::Ocean){
+				m_graph.center_biome[c] = Biome::Ocean;
+			}else if(flags & MapGraph::Water){
+				m_graph.center_biome[c] = Biome::Lake;
+			}else if((flags & MapGraph::Coast) && moisture < 0.6){
+				m_graph.center_biome[c] = Biome::Beach;
 			}else{
-				elevation_index = 0;
-			}
+				int elevation_index = 0;
+				if(m_graph.center_elevation[c] > 0.85){
+					elevation_index = 3;
+				}else if(m_graph.center_elevation[c] > 0.6){
+					elevation_index = 2;
+				}else if(elevation_index > 0.3){
+					elevation_index = 1;
+				}else{
+					elevation_index = 0;
+				}
 
-			int moisture_index = std::min((int) floor(c->moisture * 6), 5);
-			c->biome = elevation_moisture_matrix[moisture_index][elevation_index];
+				int moisture_index = std::min((int) floor(moisture * 6), 5);
+				m_graph.center_biome[c] = elevation_moisture_matrix[moisture_index][elevation_index];
+			}
 		}
-	}
+	});
 }
 
 void Map::FinishInfo(){
-	center::PVIter center_iter, centers_end = centers.end();
-	for(center_iter = centers.begin(); center_iter != centers_end; center_iter++){
-		(*center_iter)->SortCorners();
-	}
+	m_graph.FinishInfo(m_thread_pool);
+}
 
-	for  (center * c  : centers) {
-		for  (edge * e : c->edges) {
-			center *aux_center = e->GetOpositeCenter(c);
-			if(aux_center != nullptr)
-				c->centers.push_back(aux_center);
-		}
-	}
-	for (corner * c  : corners) {
-		for (edge * e : c->edges) {
-			corner * aux_corner = e->GetOpositeCorner(c);
-			if(aux_corner != nullptr)
-				c->corners.push_back(aux_corner);
+// The boxes are computed in parallel, the tree is filled by a single thread.
+void Map::PopulateQuadtree()
+{
+	std::vector<std::pair<Vec2,Vec2> > boxes(m_graph.center_count);
+	m_thread_pool.ParallelFor(0, m_graph.center_count, 4096, [this, &boxes](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int i = p_begin; i < p_end; i++)
+		{
+			boxes[i] = m_graph.GetBoundingBox(i);
 		}
+	});
+
+	m_centers_quadtree.Clear();
+	m_quadtree_arena.Release();
+	for (unsigned int i = 0; i < m_graph.center_count; i++)
+	{
+		m_centers_quadtree.Insert2(i, AABB(boxes[i].first, boxes[i].second));
 	}
 }
 
-std::vector<corner *> Map::GetLandCorners(){
-	std::vector<corner *> land_corners;
-	for (corner * c : corners)
-		if(!c->water)
+std::vector<unsigned int> Map::GetLandCorners(){
+	unsigned int l_count = 0;
+	for (unsigned int c = 0; c < m_graph.corner_count; c++)
+		l_count += !(m_graph.corner_flags[c] & MapGraph::Water);
+
+	std::vector<unsigned int> land_corners;
+	land_corners.reserve(l_count);
+	for (unsigned int c = 0; c < m_graph.corner_count; c++)
+		if(!(m_graph.corner_flags[c] & MapGraph::Water))
 			land_corners.push_back(c);
 	return land_corners;
 }
 
-std::vector<corner *> Map::GetLakeCorners(){
-	std::vector<corner *> lake_corners;
-	for(corner * c : corners)
-		if(c->water && !c->ocean)
+std::vector<unsigned int> Map::GetLakeCorners(){
+	// The filled depressions, and the inland water of the land noise.
+	std::vector<unsigned int> lake_corners;
+	for (unsigned int c = 0; c < m_graph.corner_count; c++)
+	{
+		unsigned char flags = m_graph.corner_flags[c];
+		if((flags & MapGraph::Lake) || ((flags & MapGraph::Water) && !(flags & MapGraph::Ocean)))
 			lake_corners.push_back(c);
+	}
 	return lake_corners;
 }
 
 bool Map::IsIsland(Vec2 position)
 {
-	double water_threshold = 0.075;
-
-	if(position.x < map_width * water_threshold || position.y < map_height * water_threshold
-		|| position.x > map_width * (1 - water_threshold) || position.y > map_height * (1 - water_threshold))
-		return false;
-
-	Vec2 center_pos = Vec2(map_width / 2.0, map_height / 2.0);
-
-	position -= center_pos;
-	double x_coord = (position.x / map_width) * 4;
-	double y_coord = (position.y / map_height) * 4;
-	double noise_val = noiseMap->GetValue(x_coord, y_coord, z_coord);
-
-	position /= std::min(map_width, map_height);
-	double radius = position.Length();
-
-	double factor = radius - 0.5;
-	/*	if(radius > 0.3)
-	factor = -1 / log(radius - 0.3) / 10;
-	else
-	factor = radius - 0.3;
-	*/
-	return noise_val >= 0.3*radius + factor;
+	return IslandMargin(position) >= 0;
 }
 
-void Map::Triangulate(std::vector<del::vertex> puntos)
+// How far above the land threshold the noise is, negative over water.
+double Map::IslandMargin(Vec2 position)
 {
-	int corner_index = 0, center_index = 0, edge_index = 0;
-	corners.clear();
-	centers.clear();
-	edges.clear();
-	pos_cen_map.clear();
-
-	del::vertexSet v (puntos.begin(), puntos.end());
-	del::triangleSet tris;
-	del::edgeSet edg;
-	del::Delaunay dela;
+	float margin;
+	IslandMargins(&position, 1, &margin);
+	return margin;
+}
 
-	dela.Triangulate(v, tris);
+// The noise is evaluated in batches, on the plane of z_coord.
+void Map::IslandMargins(const Vec2 * p_positions, size_t p_count, float * r_margins)
+{
+	static const size_t BATCH_SIZE = 1024;
+	double water_threshold = 0.075;
+	Vec2 center_pos = Vec2(map_width / 2.0, map_height / 2.0);
 
-	for (const del::triangle& t : tris)
+	float x_coords[BATCH_SIZE], y_coords[BATCH_SIZE], noise_vals[BATCH_SIZE];
+	for (size_t begin = 0; begin < p_count; begin += BATCH_SIZE)
 	{
-		Vec2 pos_center_0( t.GetVertex(0)->GetX(), t.GetVertex(0)->GetY());
-		Vec2 pos_center_1( t.GetVertex(1)->GetX(), t.GetVertex(1)->GetY());
-		Vec2 pos_center_2( t.GetVertex(2)->GetX(), t.GetVertex(2)->GetY());
-
-		center * c1 = GetCenter(pos_center_0);
-		if(c1 == nullptr){
-			c1 = new center(center_index++, pos_center_0);
-			centers.push_back(c1);
-			AddCenter(c1);
-		}
-		center * c2 = GetCenter(pos_center_1);
-		if(c2 == nullptr){
-			c2 = new center(center_index++, pos_center_1);
-			centers.push_back(c2);
-			AddCenter(c2);
-		}
-		center * c3 = GetCenter(pos_center_2);
-		if(c3 == nullptr){
-			c3 = new center(center_index++, pos_center_2);
-			centers.push_back(c3);
-			AddCenter(c3);
-		}
-
-		corner * c = new corner(corner_index++, Vec2());
-		corners.push_back(c);
-		c->centers.push_back(c1);
-		c->centers.push_back(c2);
-		c->centers.push_back(c3);
-		c1->corners.push_back(c);
-		c2->corners.push_back(c);
-		c3->corners.push_back(c);
-		c->position = c->CalculateCircumcenter();
-
-		edge * e12 = c1->GetEdgeWith(c2);
-		if(e12 == nullptr)
+		size_t count = std::min(BATCH_SIZE, p_count - begin);
+		for (size_t i = 0; i < count; i++)
 		{
-			e12 = new edge(edge_index++, c1, c2, nullptr, nullptr);
-			e12->v0 = c;
-			edges.push_back(e12);
-			c1->edges.push_back(e12);
-			c2->edges.push_back(e12);
-		}else{
-			e12->v1 = c;
+			Vec2 position = p_positions[begin + i] - center_pos;
+			x_coords[i] = (float) ((position.x / map_width) * 4);
+			y_coords[i] = (float) ((position.y / map_height) * 4);
 		}
-		c->edges.push_back(e12);
-
-		edge * e23 = c2->GetEdgeWith(c3);
-		if(e23 == NULL)
-		{			
-			e23 = new edge(edge_index++, c2, c3, nullptr, nullptr);
-			e23->v0 = c;
-			edges.push_back(e23);
-			c2->edges.push_back(e23);
-			c3->edges.push_back(e23);
-		}else{
-			e23->v1 = c;
-		}
-		c->edges.push_back(e23);
+		m_land_noise.GetValues(x_coords, y_coords, count, noise_vals);
 
-		edge * e31 = c3->GetEdgeWith(c1);
-		if(e31 == nullptr)
-		{
-			e31 = new edge(edge_index++, c3, c1, nullptr, nullptr);
-			e31->v0 = c;
-			edges.push_back(e31);
-			c3->edges.push_back(e31);
-			c1->edges.push_back(e31);
-		}else
+		for (size_t i = 0; i < count; i++)
 		{
-			e31->v1 = c;
+			Vec2 position = p_positions[begin + i];
+			if(position.x < map_width * water_threshold || position.y < map_height * water_threshold
+				|| position.x > map_width * (1 - water_threshold) || position.y > map_height * (1 - water_threshold))
+			{
+				r_margins[begin + i] = -1;
+				continue;
+			}
+
+			position -= center_pos;
+			position /= std::min(map_width, map_height);
+			double radius = position.Length();
+
+			double factor = radius - 0.5;
+			r_margins[begin + i] = (float) (noise_vals[i] - (0.3*radius + factor));
 		}
-		c->edges.push_back(e31);
 	}
+}
+
+// The Perlin module of the land and its slice at z_coord, which covers the
+// noise coordinates of the whole map.
+void Map::ResetLandNoise()
+{
+	noiseMap.reset(new noise::module::Perlin());
+	m_land_noise.Build(*noiseMap, z_coord, -2, -2, 2, 2);
+}
+
+void Map::Triangulate(const std::vector<del::vertex>& puntos)
+{
+	del::Triangulator triangulator;
+	triangulator.SetThreadCount(m_thread_count);
+	triangulator.Triangulate(puntos);
 
+	m_graph.Build(puntos, triangulator);
+	m_pointer_graph_ready = false;
 }
 
-void Map::AddCenter(center * c){
-	std::map<double, std::map<double, center *> >::const_iterator it = pos_cen_map.find(c->position.x);
-	if(it != pos_cen_map.end())
+void Map::GeneratePoints()
+{
+	std::vector<std::pair<double,double> > new_points;
+	if (m_point_sampler == PointSampler::TileSet && m_tile_set != nullptr && !m_tile_set->IsEmpty())
 	{
-		pos_cen_map[(int) c->position.x][c->position.y] = c;
-	}else
+		new_points = m_tile_set->Generate(map_width, map_height, m_point_spread, m_random.Split("points"));
+	}
+	else if (m_point_sampler == PointSampler::Tiled)
 	{
-		pos_cen_map[(int) c->position.x] = std::map<double, center*>();
-		pos_cen_map[(int) c->position.x][c->position.y] = c;
+		TiledPoissonDiskSampling pds(map_width, map_height, m_point_spread, 10, m_random.Split("points"));
+		pds.SetThreadCount(m_thread_count);
+		new_points = pds.Generate();
 	}
-}
-
-center * Map::GetCenter(Vec2 position){
-	std::map<double, std::map<double, center *> >::const_iterator it = pos_cen_map.find(position.x);
-	if(it != pos_cen_map.end())
+	else if (m_point_sampler == PointSampler::Variable && m_coarse_spread > m_point_spread)
 	{
-		std::map<double, center *>::const_iterator it2 = it->second.find(position.y);
-		if(it2 != it->second.end())
+		// The island margin on a raster of the coarse spread, interpolated in
+		// between. Land and water up to COAST_FALLOFF below the threshold get
+		// the point spread, deeper water fades to the coarse spread.
+		static const double COAST_FALLOFF = 0.15;
+		if (!noiseMap) ResetLandNoise();
+
+		double step = m_coarse_spread;
+		int columns = (int) (map_width / step) + 2, rows = (int) (map_height / step) + 2;
+		std::vector<Vec2> raster;
+		raster.reserve((size_t) columns * rows);
+		for (int j = 0; j < rows; j++)
+			for (int i = 0; i < columns; i++)
+				raster.push_back(Vec2(i * step, j * step));
+		std::vector<float> margins(raster.size());
+		IslandMargins(raster.data(), raster.size(), margins.data());
+
+		double fine = m_point_spread, coarse = m_coarse_spread;
+		auto spread_at = [&margins, columns, step, fine, coarse](double x, double y)
 		{
-			return it2->second;
-		}
+			double u = x / step, v = y / step;
+			int i = (int) u, j = (int) v;
+			u -= i;
+			v -= j;
+			const float * m = &margins[j * columns + i];
+			double margin = (m[0] * (1 - u) + m[1] * u) * (1 - v) + (m[columns] * (1 - u) + m[columns + 1] * u) * v;
+			double t = std::min(std::max(-margin / COAST_FALLOFF, 0.0), 1.0);
+			return fine + (coarse - fine) * t;
+		};
+
+		VariablePoissonDiskSampling pds(map_width, map_height, fine, coarse, spread_at, 10, m_random.Split("points"));
+		new_points = pds.Generate();
+	}
+	else
+	{
+		PoissonDiskSampling pds(map_width, map_height, m_point_spread, 10, m_random.Split("points"));
+		new_points = pds.Generate();
 	}
 
-	return NULL;
-}
-
-void Map::GeneratePoints()
-{
-	PoissonDiskSampling pds(800, 600, m_point_spread, 10);
-	std::vector<std::pair<double,double> > new_points = pds.Generate();
-	
-	std::cout << "Generating " << new_points.size() << " points..." << std::endl;
-	
+	points.clear();
+	points.reserve(new_points.size() + 4);
 	for (std::pair<double,double> p : new_points)
 	{
-		points.push_back(del::vertex((int) p.first, (int) p.second));
+		points.push_back(del::vertex(p.first, p.second));
 	}
 	points.push_back(del::vertex(- map_width	,- map_height));
 	points.push_back(del::vertex(2 * map_width	,- map_height));
 	points.push_back(del::vertex(2 * map_width	,2 * map_height));
 	points.push_back(del::vertex(- map_width	,2 * map_height));
+
+	switch (m_insertion_order)
+	{
+	case InsertionOrder::Hilbert:
+		del::HilbertSort(points);
+		break;
+	case InsertionOrder::Brio:
+		del::BrioSort(points, m_random.Split("brio").Next());
+		break;
+	default:
+		break;
+	}
 }
 
 void Map::LloydRelaxation()
 {
 	std::vector<del::vertex> new_points;
-	for (center * p : centers) {
-		if(!p->IsInsideBoundingBox(map_width, map_height)){
-			new_points.push_back(del::vertex((int)p->position.x, (int) p->position.y));
+	for (unsigned int p = 0; p < m_graph.center_count; p++) {
+		const Vec2& position = m_graph.center_position[p];
+		if(!m_graph.IsInsideBoundingBox(position, map_width, map_height)){
+			new_points.push_back(del::vertex(position.x, position.y));
 			continue;
 		}
-		Vec2 center_centroid;		
-		for (corner * q : p->corners)	{
-			if(q->IsInsideBoundingBox(map_width, map_height)){
-				center_centroid += q->position;
-			}else{
-				Vec2 corner_pos = q->position;
+		Vec2 center_centroid;
+		unsigned int begin = m_graph.center_corners_offset[p], end = m_graph.center_corners_offset[p + 1];
+		for (unsigned int i = begin; i < end; i++)	{
+			Vec2 corner_pos = m_graph.corner_position[m_graph.center_corners[i]];
+			if(!m_graph.IsInsideBoundingBox(corner_pos, map_width, map_height)){
 				if(corner_pos.x < 0){
 					corner_pos.x = 0;
 				}else if(corner_pos.x >= map_width){
@@ -682,67 +746,133 @@ void Map::LloydRelaxation()
 				}else if(corner_pos.y >= map_height){
 					corner_pos.y = map_height;
 				}
-				center_centroid += corner_pos;
 			}
+			center_centroid += corner_pos;
 		}
-		center_centroid /= p->corners.size();
-		new_points.push_back(del::vertex((int)center_centroid.x, (int)center_centroid.y));
+		center_centroid /= (end - begin);
+		new_points.push_back(del::vertex(center_centroid.x, center_centroid.y));
 	}
 	Triangulate(new_points);
 }
 
+void Map::SetInsertionOrder(InsertionOrder::Type p_order)
+{
+	m_insertion_order = p_order;
+}
+
+void Map::SetPointSampler(PointSampler::Type p_sampler)
+{
+	m_point_sampler = p_sampler;
+}
+
+void Map::SetRiverModel(RiverModel::Type p_model)
+{
+	m_river_model = p_model;
+}
+
+void Map::SetErosionIterations(unsigned int p_iterations)
+{
+	m_erosion_iterations = p_iterations;
+}
+
+void Map::SetCoarseSpread(double p_spread)
+{
+	m_coarse_spread = p_spread;
+}
+
+void Map::SetTileSet(const PoissonTileSet * p_tile_set)
+{
+	m_tile_set = p_tile_set;
+}
+
+void Map::SetThreadCount(unsigned int p_thread_count)
+{
+	m_thread_count = std::max(1u, p_thread_count);
+	m_thread_pool.SetThreadCount(m_thread_count);
+}
+
 std::vector<center *> Map::GetCenters()
 {
+	ExportPointerGraph();
 	return centers;
 }
 
 std::vector<corner *> Map::GetCorners()
 {
+	ExportPointerGraph();
 	return corners;
 }
 
 std::vector<edge *> Map::GetEdges()
 {
+	ExportPointerGraph();
 	return edges;
 }
 
-unsigned int Map::HashString(std::string seed){
-	unsigned int hash = 0;
-	for(int i = 0; i < seed.length(); i++) {
-		hash += ((int) seed[i]) * pow(2, i);
-	}
-	return hash % UINT_MAX;
+const MapGraph& Map::GetGraph() const
+{
+	return m_graph;
+}
+
+void Map::ExportPointerGraph()
+{
+	if(m_pointer_graph_ready)
+		return;
+
+	m_arena.Release();
+	m_graph.Export(m_arena, centers, corners, edges);
+	m_pointer_graph_ready = true;
+}
+
+const std::string& Map::GetSeed() const
+{
+	return m_seed;
+}
+
+Random Map::GetRandom(const std::string& p_stream) const
+{
+	return m_random.Split(p_stream);
+}
+
+const std::vector<std::string>& Map::GetCriticalPath() const
+{
+	return m_critical_path;
+}
+
+const std::vector<std::pair<std::string,double> >& Map::GetStageTimes() const
+{
+	return m_stage_times;
 }
 
 std::string Map::CreateSeed(int length){
-	srand(time(nullptr));
+	Random random((uint64_t) time(nullptr));
 	static const char alphanum[] =
 		"0123456789"
 		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 		"abcdefghijklmnopqrstuvwxyz";
 	std::string seed;
 	for (int i = 0; i < length; ++i) {
-		seed.push_back(alphanum[rand() % (sizeof(alphanum) - 1)]);
+		seed.push_back(alphanum[random.NextIndex(sizeof(alphanum) - 1)]);
 	}
 	return seed;
 }
 
 center * Map::GetCenterAt(Vec2 p_pos)
 {
-	center * r_center = nullptr;
-	std::vector<center *> l_aux_centers = m_centers_quadtree.QueryRange(p_pos);
-
-	if(l_aux_centers.size() > 0)
-	{
-		double l_min_dist = Vec2(l_aux_centers[0]->position, p_pos).Length();
-		r_center = l_aux_centers[0];
-		for(int i = 1; i < l_aux_centers.size(); i++){
-			double l_new_dist = Vec2(l_aux_centers[i]->position, p_pos).Length();
-			if(l_new_dist < l_min_dist){
-				l_min_dist = l_new_dist;
-				r_center = l_aux_centers[i];
-			}
-		}	
+	std::vector<unsigned int> l_aux_centers = m_centers_quadtree.QueryRange(p_pos);
+	if(l_aux_centers.empty())
+		return nullptr;
+
+	unsigned int r_center = l_aux_centers[0];
+	double l_min_dist = Vec2(m_graph.center_position[r_center], p_pos).Length();
+	for(int i = 1; i < l_aux_centers.size(); i++){
+		double l_new_dist = Vec2(m_graph.center_position[l_aux_centers[i]], p_pos).Length();
+		if(l_new_dist < l_min_dist){
+			l_min_dist = l_new_dist;
+			r_center = l_aux_centers[i];
+		}
 	}
-	return r_center;
-}
\ No newline at end of file
+
+	ExportPointerGraph();
+	return centers[r_center];
+}
@@ -0,0 +1,615 @@
+#include "MapGenerator/MapGraph.h"
+#include "MapGenerator/RankSort.h"
+#include "MapGenerator/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+const unsigned int MapGraph::INVALID_INDEX;
+
+void MapGraph::Build(const std::vector<del::vertex>& p_points, const del::Triangulator& p_triangulator)
+{
+	Clear();
+
+	const std::vector<unsigned int>& triangles = p_triangulator.GetTriangles();
+	const std::vector<unsigned int>& halfedges = p_triangulator.GetHalfedges();
+	const std::vector<double>& circumcenters = p_triangulator.GetCircumcenters();
+
+	// One center per input point, in input order. Repeated points aren't part
+	// of any triangle and get no center.
+	std::vector<unsigned int> l_point_center(p_points.size(), INVALID_INDEX);
+	unsigned int l_used_count = 0;
+	for (unsigned int v : triangles)
+	{
+		if (l_point_center[v] == INVALID_INDEX) l_used_count++;
+		l_point_center[v] = 0;
+	}
+	center_position.reserve(l_used_count);
+	for (size_t i = 0; i < p_points.size(); i++)
+	{
+		if (l_point_center[i] == INVALID_INDEX) continue;
+		l_point_center[i] = center_count++;
+		center_position.push_back(Vec2(p_points[i].GetX(), p_points[i].GetY()));
+	}
+
+	// Corners of every center, in triangle order until FinishInfo sorts them.
+	center_corners_offset.assign(center_count + 1, 0);
+	for (unsigned int v : triangles)
+		center_corners_offset[l_point_center[v] + 1]++;
+	for (unsigned int c = 0; c < center_count; c++)
+		center_corners_offset[c + 1] += center_corners_offset[c];
+	center_corners.resize(triangles.size());
+	std::vector<unsigned int> l_cursor(center_corners_offset.begin(), center_corners_offset.end() - 1);
+
+	corner_count = (unsigned int) (triangles.size() / 3);
+	corner_position.resize(corner_count);
+	corner_centers.resize(triangles.size());
+	corner_edges.resize(triangles.size());
+
+	// The first of the two twin half-edges to be visited creates the edge.
+	std::vector<unsigned int> l_halfedge_edges(halfedges.size(), INVALID_INDEX);
+	size_t l_edge_count = 0;
+	for (size_t he = 0; he < halfedges.size(); he++)
+		l_edge_count += halfedges[he] == INVALID_INDEX || halfedges[he] > he;
+	edge_centers.reserve(2 * l_edge_count);
+	edge_corners.reserve(2 * l_edge_count);
+	for (unsigned int q = 0; q < corner_count; q++)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int c = l_point_center[triangles[3 * q + k]];
+			corner_centers[3 * q + k] = c;
+			center_corners[l_cursor[c]++] = q;
+		}
+		corner_position[q] = Vec2(circumcenters[2 * q], circumcenters[2 * q + 1]);
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int he = 3 * q + k;
+			unsigned int e = l_halfedge_edges[he];
+			if (e == INVALID_INDEX)
+			{
+				e = edge_count++;
+				edge_centers.push_back(corner_centers[3 * q + k]);
+				edge_centers.push_back(corner_centers[3 * q + (k + 1) % 3]);
+				edge_corners.push_back(q);
+				edge_corners.push_back(INVALID_INDEX);
+				if (halfedges[he] != INVALID_INDEX)
+					l_halfedge_edges[halfedges[he]] = e;
+			}else{
+				edge_corners[2 * e + 1] = q;
+			}
+			corner_edges[he] = e;
+		}
+	}
+
+	center_elevation.assign(center_count, 0.0);
+	center_moisture.assign(center_count, 0.0);
+	center_flags.assign(center_count, 0);
+	center_biome.assign(center_count, (unsigned char) Biome::None);
+
+	corner_elevation.assign(corner_count, 0.0);
+	corner_moisture.assign(corner_count, 0.0);
+	corner_river_volume.assign(corner_count, 0.0);
+	corner_flags.assign(corner_count, 0);
+	corner_downslope_edge.assign(corner_count, INVALID_INDEX);
+
+	edge_river_volume.assign(edge_count, 0.0);
+}
+
+void MapGraph::FinishInfo(ThreadPool& p_pool)
+{
+	// Same insertion sort as center::SortCorners, GoesBefore isn't a strict
+	// order so the algorithm matters.
+	p_pool.ParallelFor(0, center_count, 4096, [this](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int c = p_begin; c < p_end; c++)
+		{
+			unsigned int begin = center_corners_offset[c];
+			unsigned int end = center_corners_offset[c + 1];
+			for (unsigned int i = begin + 1; i < end; i++)
+			{
+				unsigned int item = center_corners[i];
+				unsigned int hole = i;
+				while (hole > begin && center::GoesBefore(center_position[c], corner_position[item], corner_position[center_corners[hole - 1]]))
+				{
+					center_corners[hole] = center_corners[hole - 1];
+					hole--;
+				}
+				center_corners[hole] = item;
+			}
+		}
+	});
+
+	center_centers_offset.assign(center_count + 1, 0);
+	for (unsigned int e = 0; e < edge_count; e++)
+	{
+		center_centers_offset[edge_centers[2 * e] + 1]++;
+		center_centers_offset[edge_centers[2 * e + 1] + 1]++;
+	}
+	for (unsigned int c = 0; c < center_count; c++)
+		center_centers_offset[c + 1] += center_centers_offset[c];
+	center_centers.resize(center_centers_offset[center_count]);
+	std::vector<unsigned int> l_cursor(center_centers_offset.begin(), center_centers_offset.end() - 1);
+	for (unsigned int e = 0; e < edge_count; e++)
+	{
+		unsigned int d0 = edge_centers[2 * e], d1 = edge_centers[2 * e + 1];
+		center_centers[l_cursor[d0]++] = d1;
+		center_centers[l_cursor[d1]++] = d0;
+	}
+
+	// Every edge but the ones on the hull links two corners. The neighbours
+	// are counted first, so every corner knows where to write its own.
+	corner_corners_offset.assign(corner_count + 1, 0);
+	p_pool.ParallelFor(0, corner_count, 8192, [this](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int q = p_begin; q < p_end; q++)
+			for (unsigned int k = 0; k < 3; k++)
+				corner_corners_offset[q + 1] += GetOpositeCorner(corner_edges[3 * q + k], q) != INVALID_INDEX;
+	});
+	for (unsigned int q = 0; q < corner_count; q++)
+		corner_corners_offset[q + 1] += corner_corners_offset[q];
+	corner_corners.resize(corner_corners_offset[corner_count]);
+	p_pool.ParallelFor(0, corner_count, 8192, [this](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int q = p_begin; q < p_end; q++)
+		{
+			unsigned int cursor = corner_corners_offset[q];
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int r = GetOpositeCorner(corner_edges[3 * q + k], q);
+				if (r != INVALID_INDEX)
+					corner_corners[cursor++] = r;
+			}
+		}
+	});
+}
+
+void MapGraph::Clear()
+{
+	center_count = corner_count = edge_count = 0;
+
+	center_position.clear();
+	center_elevation.clear();
+	center_moisture.clear();
+	center_flags.clear();
+	center_biome.clear();
+	center_corners_offset.clear();
+	center_corners.clear();
+	center_centers_offset.clear();
+	center_centers.clear();
+
+	corner_position.clear();
+	corner_elevation.clear();
+	corner_moisture.clear();
+	corner_river_volume.clear();
+	corner_flags.clear();
+	corner_downslope_edge.clear();
+	corner_centers.clear();
+	corner_edges.clear();
+	corner_corners_offset.clear();
+	corner_corners.clear();
+
+	edge_centers.clear();
+	edge_corners.clear();
+	edge_river_volume.clear();
+}
+
+std::pair<Vec2,Vec2> MapGraph::GetBoundingBox(unsigned int p_center) const
+{
+	unsigned int begin = center_corners_offset[p_center];
+	unsigned int end = center_corners_offset[p_center + 1];
+
+	const Vec2& first = corner_position[center_corners[begin]];
+	double l_min_x = first.x, l_max_x = first.x;
+	double l_min_y = first.y, l_max_y = first.y;
+	for (unsigned int i = begin + 1; i < end; i++)
+	{
+		const Vec2& pos = corner_position[center_corners[i]];
+		if (pos.x < l_min_x) {
+			l_min_x = pos.x;
+		} else if (pos.x > l_max_x) {
+			l_max_x = pos.x;
+		}
+		if (pos.y < l_min_y) {
+			l_min_y = pos.y;
+		} else if (pos.y > l_max_y) {
+			l_max_y = pos.y;
+		}
+	}
+
+	Vec2 l_min_pos(l_min_x, l_min_y);
+	Vec2 l_max_pos(l_max_x, l_max_y);
+	Vec2 l_half_diagonal(Vec2(l_min_pos, l_max_pos) / 2);
+
+	return std::make_pair(l_min_pos + l_half_diagonal, l_half_diagonal);
+}
+
+// Dial's algorithm on the step costs counted in hundredths, 1 and 101, with
+// a ring of 102 buckets. A corner is settled once every corner a hundredth
+// closer is, so its distance is the smallest of the ones all its shortest
+// paths give in floating point, the same the relaxation to a fixed point of
+// the old FIFO queue ended with.
+size_t MapGraph::DistanceToBorder(std::vector<double>& r_distance) const
+{
+	static const unsigned int LAND_STEP = 101;
+	static const unsigned int BUCKET_COUNT = LAND_STEP + 1;
+	static const unsigned int UNREACHED = 0xffffffff;
+
+	r_distance.assign(corner_count, 99999);
+	std::vector<unsigned int> steps(corner_count, UNREACHED);
+	std::vector<unsigned char> settled(corner_count, 0);
+	std::vector<std::vector<unsigned int> > buckets(BUCKET_COUNT);
+
+	size_t pushes = 0, pending = 0;
+	for (unsigned int q = 0; q < corner_count; q++)
+	{
+		if (corner_flags[q] & Border)
+		{
+			r_distance[q] = 0.0;
+			steps[q] = 0;
+			buckets[0].push_back(q);
+			pushes++;
+			pending++;
+		}
+	}
+
+	for (unsigned int d = 0; pending > 0; d++)
+	{
+		// Steps are at least 1, so nothing lands in the bucket being emptied.
+		std::vector<unsigned int>& bucket = buckets[d % BUCKET_COUNT];
+		pending -= bucket.size();
+		for (size_t b = 0; b < bucket.size(); b++)
+		{
+			unsigned int q = bucket[b];
+			// Entries left behind by a later, shorter path.
+			if (settled[q] || steps[q] != d) continue;
+			settled[q] = 1;
+
+			bool q_land = !(corner_flags[q] & Water);
+			for (unsigned int i = corner_corners_offset[q]; i < corner_corners_offset[q + 1]; i++)
+			{
+				unsigned int s = corner_corners[i];
+				if (settled[s]) continue;
+
+				double distance = r_distance[q] + 0.01;
+				unsigned int s_steps = d + 1;
+				if (q_land && !(corner_flags[s] & Water))
+				{
+					distance += 1;
+					s_steps = d + LAND_STEP;
+				}
+
+				if (s_steps < steps[s])
+				{
+					steps[s] = s_steps;
+					r_distance[s] = distance;
+					buckets[s_steps % BUCKET_COUNT].push_back(s);
+					pushes++;
+					pending++;
+				}
+				else if (s_steps == steps[s] && distance < r_distance[s])
+				{
+					r_distance[s] = distance;
+				}
+			}
+		}
+		bucket.clear();
+	}
+	return pushes;
+}
+
+unsigned int MapGraph::FillDepressions(ThreadPool& p_pool)
+{
+	// The corners above the level of the flood wait by rank of elevation, in
+	// a bitmap: the level only goes up, so the next one is the first bit set
+	// after the rank of the last. The ones reached at or below the level are
+	// in a depression, they are raised to that level and go through a plain
+	// FIFO queue, ahead of the ranks.
+	std::vector<unsigned int> order(corner_count);
+	for (unsigned int q = 0; q < corner_count; q++) order[q] = q;
+	RankSort(corner_elevation, order, p_pool);
+	std::vector<unsigned int> rank(corner_count);
+	for (unsigned int i = 0; i < corner_count; i++) rank[order[i]] = i;
+
+	std::vector<uint64_t> waiting((corner_count + 63) / 64, 0);
+	std::vector<unsigned int> pit;
+	size_t pit_head = 0;
+	std::vector<unsigned char> queued(corner_count, 0), flooded(corner_count, 0);
+
+	for (unsigned int q = 0; q < corner_count; q++)
+	{
+		corner_flags[q] &= ~Lake;
+		if (corner_flags[q] & Ocean)
+		{
+			waiting[rank[q] / 64] |= (uint64_t) 1 << (rank[q] % 64);
+			queued[q] = 1;
+		}
+	}
+
+	unsigned int lake_count = 0, next_rank = 0;
+	double level = 0;
+	for (;;)
+	{
+		unsigned int q;
+		if (pit_head < pit.size())
+		{
+			q = pit[pit_head++];
+		}
+		else
+		{
+			while (next_rank < corner_count)
+			{
+				uint64_t bits = waiting[next_rank / 64] >> (next_rank % 64);
+				if (bits & 1) break;
+				next_rank = bits ? next_rank + 1 : (next_rank | 63) + 1;
+			}
+			if (next_rank >= corner_count) break;
+
+			pit.clear();
+			pit_head = 0;
+			q = order[next_rank++];
+			level = corner_elevation[q];
+		}
+		flooded[q] = 1;
+
+		if (!(corner_flags[q] & Ocean))
+		{
+			// The corner it was reached from is flooded, there is always one.
+			unsigned int d_edge = INVALID_INDEX;
+			double d_elevation = 0;
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int e = corner_edges[3 * q + k];
+				unsigned int s = GetOpositeCorner(e, q);
+				if (s != INVALID_INDEX && flooded[s] && (d_edge == INVALID_INDEX || corner_elevation[s] < d_elevation))
+				{
+					d_edge = e;
+					d_elevation = corner_elevation[s];
+				}
+			}
+			corner_downslope_edge[q] = d_edge;
+
+			if (corner_elevation[q] < level)
+			{
+				corner_elevation[q] = level;
+				corner_flags[q] |= Lake;
+				lake_count++;
+			}
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int s = GetOpositeCorner(corner_edges[3 * q + k], q);
+			if (s == INVALID_INDEX || queued[s]) continue;
+
+			queued[s] = 1;
+			if (corner_elevation[s] <= level)
+				pit.push_back(s);
+			else
+				waiting[rank[s] / 64] |= (uint64_t) 1 << (rank[s] % 64);
+		}
+	}
+	return lake_count;
+}
+
+// Lowering per iteration for a slope of one mean edge length and a single
+// corner draining through it.
+static const double STREAM_POWER = 0.002;
+// Fraction of the way to the mean of the neighbours per iteration.
+static const double HILLSLOPE_DIFFUSION = 0.05;
+// Shortest link the slopes are measured over, in mean lengths.
+static const double MIN_LINK_LENGTH = 0.001;
+
+void MapGraph::Erode(unsigned int p_iterations, ThreadPool& p_pool)
+{
+	if (corner_corners.empty()) return;
+
+	// Length of every corner-corner link, in mean lengths so the slopes
+	// don't depend on the spacing of the points.
+	std::vector<double> length(corner_corners.size());
+	p_pool.ParallelFor(0, corner_count, 8192, [this, &length](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int q = p_begin; q < p_end; q++)
+		{
+			for (unsigned int i = corner_corners_offset[q]; i < corner_corners_offset[q + 1]; i++)
+			{
+				length[i] = corner_position[q].Distance(corner_position[corner_corners[i]]);
+			}
+		}
+	});
+	double length_sum = 0;
+	for (double l : length) length_sum += l;
+	double mean_length = length_sum / length.size();
+	if (!(mean_length > 0)) return;
+	// Cocircular points give corners at the same place, the links between
+	// them count as short ones instead of dividing by zero.
+	for (double& l : length) l = std::max(l, mean_length * MIN_LINK_LENGTH);
+
+	std::vector<double> height(corner_elevation), next(corner_count);
+	std::vector<unsigned int> receiver(corner_count), receiver_link(corner_count), upstream(corner_count), ready;
+	std::vector<double> drainage(corner_count);
+	ready.reserve(corner_count);
+
+	for (unsigned int iteration = 0; iteration < p_iterations; iteration++)
+	{
+		p_pool.ParallelFor(0, corner_count, 8192, [this, &height, &receiver, &receiver_link](unsigned int p_begin, unsigned int p_end)
+		{
+			for (unsigned int q = p_begin; q < p_end; q++)
+			{
+				unsigned int r = INVALID_INDEX, link = 0;
+				if (!(corner_flags[q] & Water))
+				{
+					double lowest = height[q];
+					for (unsigned int i = corner_corners_offset[q]; i < corner_corners_offset[q + 1]; i++)
+					{
+						if (height[corner_corners[i]] < lowest)
+						{
+							r = corner_corners[i];
+							link = i;
+							lowest = height[r];
+						}
+					}
+				}
+				receiver[q] = r;
+				receiver_link[q] = link;
+			}
+		});
+
+		// Every land corner drains itself and the corners upstream of it.
+		std::fill(upstream.begin(), upstream.end(), 0);
+		for (unsigned int q = 0; q < corner_count; q++)
+		{
+			drainage[q] = (corner_flags[q] & Water) ? 0.0 : 1.0;
+			if (receiver[q] != INVALID_INDEX) upstream[receiver[q]]++;
+		}
+		ready.clear();
+		for (unsigned int q = 0; q < corner_count; q++)
+			if (upstream[q] == 0) ready.push_back(q);
+		for (size_t i = 0; i < ready.size(); i++)
+		{
+			unsigned int q = ready[i], r = receiver[q];
+			if (r == INVALID_INDEX) continue;
+			drainage[r] += drainage[q];
+			if (--upstream[r] == 0) ready.push_back(r);
+		}
+
+		p_pool.ParallelFor(0, corner_count, 8192, [&](unsigned int p_begin, unsigned int p_end)
+		{
+			for (unsigned int q = p_begin; q < p_end; q++)
+			{
+				unsigned int begin = corner_corners_offset[q], end = corner_corners_offset[q + 1];
+				if ((corner_flags[q] & Water) || begin == end)
+				{
+					next[q] = height[q];
+					continue;
+				}
+
+				double mean = 0;
+				for (unsigned int i = begin; i < end; i++)
+				{
+					mean += height[corner_corners[i]];
+				}
+				double h = height[q] + HILLSLOPE_DIFFUSION * (mean / (end - begin) - height[q]);
+
+				unsigned int r = receiver[q];
+				if (r != INVALID_INDEX)
+				{
+					double drop = height[q] - height[r];
+					double slope = drop * mean_length / length[receiver_link[q]];
+					h -= std::min(drop, STREAM_POWER * std::sqrt(drainage[q]) * slope);
+				}
+				next[q] = std::max(h, 0.0);
+			}
+		});
+		height.swap(next);
+	}
+	corner_elevation.swap(height);
+}
+
+template <class T>
+static size_t Bytes(const std::vector<T>& v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+size_t MapGraph::GetMemoryUsage() const
+{
+	return Bytes(center_position) + Bytes(center_elevation) + Bytes(center_moisture) + Bytes(center_flags)
+		+ Bytes(center_biome) + Bytes(center_corners_offset) + Bytes(center_corners)
+		+ Bytes(center_centers_offset) + Bytes(center_centers)
+		+ Bytes(corner_position) + Bytes(corner_elevation) + Bytes(corner_moisture) + Bytes(corner_river_volume)
+		+ Bytes(corner_flags) + Bytes(corner_downslope_edge) + Bytes(corner_centers)
+		+ Bytes(corner_edges) + Bytes(corner_corners_offset) + Bytes(corner_corners)
+		+ Bytes(edge_centers) + Bytes(edge_corners) + Bytes(edge_river_volume);
+}
+
+void MapGraph::Export(Arena& p_arena, std::vector<center *>& r_centers, std::vector<corner *>& r_corners, std::vector<edge *>& r_edges) const
+{
+	ArenaAllocator<center *> l_centers_allocator(&p_arena);
+	ArenaAllocator<corner *> l_corners_allocator(&p_arena);
+	ArenaAllocator<edge *> l_edges_allocator(&p_arena);
+
+	r_centers.resize(center_count);
+	for (unsigned int c = 0; c < center_count; c++)
+	{
+		center * p = p_arena.New<center>(c, center_position[c]);
+		p->water = HasFlag(center_flags, c, Water);
+		p->ocean = HasFlag(center_flags, c, Ocean);
+		p->coast = HasFlag(center_flags, c, Coast);
+		p->border = HasFlag(center_flags, c, Border);
+		p->biome = (Biome::Type) center_biome[c];
+		p->elevation = center_elevation[c];
+		p->moisture = center_moisture[c];
+
+		unsigned int degree = center_centers_offset[c + 1] - center_centers_offset[c];
+		p->edges = NodeList<edge *>(l_edges_allocator);
+		p->edges.reserve(degree);
+		p->centers = NodeList<center *>(l_centers_allocator);
+		p->centers.reserve(degree);
+		p->corners = NodeList<corner *>(l_corners_allocator);
+		p->corners.reserve(center_corners_offset[c + 1] - center_corners_offset[c]);
+		r_centers[c] = p;
+	}
+
+	r_corners.resize(corner_count);
+	for (unsigned int q = 0; q < corner_count; q++)
+	{
+		corner * p = p_arena.New<corner>(q, corner_position[q]);
+		p->water = HasFlag(corner_flags, q, Water);
+		p->ocean = HasFlag(corner_flags, q, Ocean);
+		p->coast = HasFlag(corner_flags, q, Coast);
+		p->border = HasFlag(corner_flags, q, Border);
+		p->lake = HasFlag(corner_flags, q, Lake);
+		p->elevation = corner_elevation[q];
+		p->moisture = corner_moisture[q];
+		p->river_volume = corner_river_volume[q];
+
+		p->centers = NodeList<center *>(l_centers_allocator);
+		p->centers.reserve(3);
+		p->edges = NodeList<edge *>(l_edges_allocator);
+		p->edges.reserve(3);
+		p->corners = NodeList<corner *>(l_corners_allocator);
+		p->corners.reserve(corner_corners_offset[q + 1] - corner_corners_offset[q]);
+		r_corners[q] = p;
+	}
+
+	r_edges.resize(edge_count);
+	for (unsigned int e = 0; e < edge_count; e++)
+	{
+		center * d0 = r_centers[edge_centers[2 * e]];
+		center * d1 = r_centers[edge_centers[2 * e + 1]];
+		edge * p = p_arena.New<edge>(e, d0, d1, nullptr, nullptr);
+		p->v0 = r_corners[edge_corners[2 * e]];
+		p->v1 = edge_corners[2 * e + 1] == INVALID_INDEX ? nullptr : r_corners[edge_corners[2 * e + 1]];
+		p->river_volume = edge_river_volume[e];
+		d0->edges.push_back(p);
+		d1->edges.push_back(p);
+		r_edges[e] = p;
+	}
+
+	for (unsigned int c = 0; c < center_count; c++)
+	{
+		center * p = r_centers[c];
+		for (unsigned int i = center_corners_offset[c]; i < center_corners_offset[c + 1]; i++)
+			p->corners.push_back(r_corners[center_corners[i]]);
+		for (unsigned int i = center_centers_offset[c]; i < center_centers_offset[c + 1]; i++)
+			p->centers.push_back(r_centers[center_centers[i]]);
+	}
+
+	for (unsigned int q = 0; q < corner_count; q++)
+	{
+		corner * p = r_corners[q];
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			p->centers.push_back(r_centers[corner_centers[3 * q + k]]);
+			p->edges.push_back(r_edges[corner_edges[3 * q + k]]);
+		}
+		for (unsigned int i = corner_corners_offset[q]; i < corner_corners_offset[q + 1]; i++)
+			p->corners.push_back(r_corners[corner_corners[i]]);
+		p->downslope = r_corners[GetDownslope(q)];
+		if (corner_downslope_edge[q] != INVALID_INDEX)
+			p->downslope_edge = r_edges[corner_downslope_edge[q]];
+	}
+}
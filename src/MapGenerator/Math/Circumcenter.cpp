@@ -0,0 +1,74 @@
+#include "MapGenerator/Math/Circumcenter.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CIRCUMCENTER_WIDTH 4
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CIRCUMCENTER_WIDTH 2
+#else
+#define CIRCUMCENTER_WIDTH 1
+#endif
+
+void Circumcenters(const double * p_coords, const unsigned int * p_triangles, size_t p_count, double * r_centers)
+{
+	size_t t = 0;
+
+#if CIRCUMCENTER_WIDTH == 4
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d zero = _mm256_setzero_pd();
+	for (; t + 4 <= p_count; t += 4)
+	{
+		const unsigned int * v = p_triangles + 3 * t;
+		__m256d ax = _mm256_set_pd(p_coords[2 * v[9]], p_coords[2 * v[6]], p_coords[2 * v[3]], p_coords[2 * v[0]]);
+		__m256d ay = _mm256_set_pd(p_coords[2 * v[9] + 1], p_coords[2 * v[6] + 1], p_coords[2 * v[3] + 1], p_coords[2 * v[0] + 1]);
+		__m256d bx = _mm256_sub_pd(_mm256_set_pd(p_coords[2 * v[10]], p_coords[2 * v[7]], p_coords[2 * v[4]], p_coords[2 * v[1]]), ax);
+		__m256d by = _mm256_sub_pd(_mm256_set_pd(p_coords[2 * v[10] + 1], p_coords[2 * v[7] + 1], p_coords[2 * v[4] + 1], p_coords[2 * v[1] + 1]), ay);
+		__m256d cx = _mm256_sub_pd(_mm256_set_pd(p_coords[2 * v[11]], p_coords[2 * v[8]], p_coords[2 * v[5]], p_coords[2 * v[2]]), ax);
+		__m256d cy = _mm256_sub_pd(_mm256_set_pd(p_coords[2 * v[11] + 1], p_coords[2 * v[8] + 1], p_coords[2 * v[5] + 1], p_coords[2 * v[2] + 1]), ay);
+
+		__m256d d = _mm256_sub_pd(_mm256_mul_pd(bx, cy), _mm256_mul_pd(by, cx));
+		__m256d inv = _mm256_and_pd(_mm256_cmp_pd(d, zero, _CMP_NEQ_UQ), _mm256_div_pd(half, d));
+		__m256d b2 = _mm256_add_pd(_mm256_mul_pd(bx, bx), _mm256_mul_pd(by, by));
+		__m256d c2 = _mm256_add_pd(_mm256_mul_pd(cx, cx), _mm256_mul_pd(cy, cy));
+		__m256d x = _mm256_add_pd(ax, _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(cy, b2), _mm256_mul_pd(by, c2)), inv));
+		__m256d y = _mm256_add_pd(ay, _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(bx, c2), _mm256_mul_pd(cx, b2)), inv));
+
+		// x0 y0 x1 y1 | x2 y2 x3 y3
+		__m256d lo = _mm256_unpacklo_pd(x, y);
+		__m256d hi = _mm256_unpackhi_pd(x, y);
+		_mm256_storeu_pd(r_centers + 2 * t, _mm256_permute2f128_pd(lo, hi, 0x20));
+		_mm256_storeu_pd(r_centers + 2 * t + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+	}
+#elif CIRCUMCENTER_WIDTH == 2
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d zero = _mm_setzero_pd();
+	for (; t + 2 <= p_count; t += 2)
+	{
+		const unsigned int * v = p_triangles + 3 * t;
+		__m128d ax = _mm_set_pd(p_coords[2 * v[3]], p_coords[2 * v[0]]);
+		__m128d ay = _mm_set_pd(p_coords[2 * v[3] + 1], p_coords[2 * v[0] + 1]);
+		__m128d bx = _mm_sub_pd(_mm_set_pd(p_coords[2 * v[4]], p_coords[2 * v[1]]), ax);
+		__m128d by = _mm_sub_pd(_mm_set_pd(p_coords[2 * v[4] + 1], p_coords[2 * v[1] + 1]), ay);
+		__m128d cx = _mm_sub_pd(_mm_set_pd(p_coords[2 * v[5]], p_coords[2 * v[2]]), ax);
+		__m128d cy = _mm_sub_pd(_mm_set_pd(p_coords[2 * v[5] + 1], p_coords[2 * v[2] + 1]), ay);
+
+		__m128d d = _mm_sub_pd(_mm_mul_pd(bx, cy), _mm_mul_pd(by, cx));
+		__m128d inv = _mm_and_pd(_mm_cmpneq_pd(d, zero), _mm_div_pd(half, d));
+		__m128d b2 = _mm_add_pd(_mm_mul_pd(bx, bx), _mm_mul_pd(by, by));
+		__m128d c2 = _mm_add_pd(_mm_mul_pd(cx, cx), _mm_mul_pd(cy, cy));
+		__m128d x = _mm_add_pd(ax, _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(cy, b2), _mm_mul_pd(by, c2)), inv));
+		__m128d y = _mm_add_pd(ay, _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(bx, c2), _mm_mul_pd(cx, b2)), inv));
+
+		_mm_storeu_pd(r_centers + 2 * t, _mm_unpacklo_pd(x, y));
+		_mm_storeu_pd(r_centers + 2 * t + 2, _mm_unpackhi_pd(x, y));
+	}
+#endif
+
+	for (; t < p_count; t++)
+	{
+		const unsigned int * v = p_triangles + 3 * t;
+		Circumcenter(p_coords[2 * v[0]], p_coords[2 * v[0] + 1], p_coords[2 * v[1]], p_coords[2 * v[1] + 1],
+			p_coords[2 * v[2]], p_coords[2 * v[2] + 1], r_centers[2 * t], r_centers[2 * t + 1]);
+	}
+}
@@ -0,0 +1,247 @@
+#include "MapGenerator/Math/PerlinSlice.h"
+#include "noise/noise.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The AVX2 path is built on every x86-64 target and picked at run time, so
+// the build doesn't need the flag and still runs on older processors.
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define PERLIN_SLICE_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PERLIN_SLICE_TARGET
+#else
+#define PERLIN_SLICE_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// Interpolation curve of every noise quality, as in libnoise.
+static double Curve(double p_t, int p_quality)
+{
+	switch (p_quality)
+	{
+	case noise::QUALITY_FAST:
+		return p_t;
+	case noise::QUALITY_BEST:
+		return p_t * p_t * p_t * (p_t * (p_t * 6 - 15) + 10);
+	default:
+		return p_t * p_t * (3 - 2 * p_t);
+	}
+}
+
+static inline float CurveF(float p_t, int p_quality)
+{
+	switch (p_quality)
+	{
+	case noise::QUALITY_FAST:
+		return p_t;
+	case noise::QUALITY_BEST:
+		return p_t * p_t * p_t * (p_t * (p_t * 6.0f - 15.0f) + 10.0f);
+	default:
+		return p_t * p_t * (3.0f - 2.0f * p_t);
+	}
+}
+
+#if defined(PERLIN_SLICE_AVX2)
+static bool HasAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	// AVX enabled by the processor and saved by the OS, then AVX2.
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool HAS_AVX2 = HasAVX2();
+
+// A corner of the cells of 8 points: its gradient dotted with the offset of
+// the points, plus its constant.
+PERLIN_SLICE_TARGET static inline __m256 GatherCorner(const float * p_gradient_x, const float * p_gradient_y, const float * p_constant, __m256i p_index, __m256 p_dx, __m256 p_dy)
+{
+	__m256 gx = _mm256_i32gather_ps(p_gradient_x, p_index, 4);
+	__m256 gy = _mm256_i32gather_ps(p_gradient_y, p_index, 4);
+	__m256 c = _mm256_i32gather_ps(p_constant, p_index, 4);
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, p_dx), _mm256_mul_ps(gy, p_dy)), c);
+}
+#endif
+
+PerlinSlice::PerlinSlice() : m_quality(noise::QUALITY_STD)
+{
+}
+
+void PerlinSlice::Build(const noise::module::Perlin& p_perlin, double p_z, double p_min_x, double p_min_y, double p_max_x, double p_max_y)
+{
+	m_quality = p_perlin.GetNoiseQuality();
+	m_octaves.clear();
+	m_gradient_x.clear();
+	m_gradient_y.clear();
+	m_constant.clear();
+
+	double frequency = p_perlin.GetFrequency(), amplitude = 1;
+	double z = p_z * frequency;
+	for (int o = 0; o < p_perlin.GetOctaveCount(); o++)
+	{
+		Octave octave;
+		octave.frequency = (float) frequency;
+		octave.amplitude = (float) amplitude;
+		octave.origin_x = (int) std::floor(p_min_x * frequency);
+		octave.origin_y = (int) std::floor(p_min_y * frequency);
+		octave.width = (int) std::floor(p_max_x * frequency) - octave.origin_x + 2;
+		octave.height = (int) std::floor(p_max_y * frequency) - octave.origin_y + 2;
+		octave.offset = m_gradient_x.size();
+		m_octaves.push_back(octave);
+
+		// The two z layers around the plane, taken the way libnoise does.
+		double nz = noise::MakeInt32Range(z);
+		int z0 = nz > 0.0 ? (int) nz : (int) nz - 1;
+		double zs = Curve(nz - z0, m_quality);
+		int seed = (p_perlin.GetSeed() + o) & 0xffffffff;
+
+		for (int j = 0; j < octave.height; j++)
+		{
+			for (int i = 0; i < octave.width; i++)
+			{
+				int ix = octave.origin_x + i, iy = octave.origin_y + j;
+				double gradient_x[2], gradient_y[2], constant[2];
+				for (int k = 0; k < 2; k++)
+				{
+					constant[k] = noise::GradientNoise3D(ix, iy, nz, ix, iy, z0 + k, seed);
+					gradient_x[k] = noise::GradientNoise3D(ix + 1, iy, nz, ix, iy, z0 + k, seed) - constant[k];
+					gradient_y[k] = noise::GradientNoise3D(ix, iy + 1, nz, ix, iy, z0 + k, seed) - constant[k];
+				}
+				m_gradient_x.push_back((float) (gradient_x[0] + (gradient_x[1] - gradient_x[0]) * zs));
+				m_gradient_y.push_back((float) (gradient_y[0] + (gradient_y[1] - gradient_y[0]) * zs));
+				m_constant.push_back((float) (constant[0] + (constant[1] - constant[0]) * zs));
+			}
+		}
+
+		frequency *= p_perlin.GetLacunarity();
+		z *= p_perlin.GetLacunarity();
+		amplitude *= p_perlin.GetPersistence();
+	}
+}
+
+float PerlinSlice::GetValue(float p_x, float p_y) const
+{
+	float value;
+	GetValues(&p_x, &p_y, 1, &value);
+	return value;
+}
+
+void PerlinSlice::GetValues(const float * p_x, const float * p_y, size_t p_count, float * r_values) const
+{
+	size_t p = 0;
+
+#if defined(PERLIN_SLICE_AVX2)
+	if (HAS_AVX2)
+	{
+		for (; p + 8 <= p_count; p += 8)
+		{
+			getValuesAVX2(p_x + p, p_y + p, r_values + p);
+		}
+	}
+#endif
+
+	// The rest, and everything without AVX2. The operations are the same as
+	// in the lanes, in the same order, so no point depends on where it falls
+	// in the batch.
+
+	for (; p < p_count; p++)
+	{
+		float value = 0;
+		for (const Octave& octave : m_octaves)
+		{
+			float fx = p_x[p] * octave.frequency, fy = p_y[p] * octave.frequency;
+			float x0 = std::floor(fx), y0 = std::floor(fy);
+			float xs = fx - x0, ys = fy - y0;
+			float xs1 = xs - 1.0f, ys1 = ys - 1.0f;
+
+			int ix = std::min(std::max((int) x0 - octave.origin_x, 0), octave.width - 2);
+			int iy = std::min(std::max((int) y0 - octave.origin_y, 0), octave.height - 2);
+			size_t index = octave.offset + (size_t) iy * octave.width + ix;
+
+			const float * gradient_x = &m_gradient_x[index];
+			const float * gradient_y = &m_gradient_y[index];
+			const float * constant = &m_constant[index];
+			size_t w = octave.width;
+			float n00 = (gradient_x[0] * xs + gradient_y[0] * ys) + constant[0];
+			float n10 = (gradient_x[1] * xs1 + gradient_y[1] * ys) + constant[1];
+			float n01 = (gradient_x[w] * xs + gradient_y[w] * ys1) + constant[w];
+			float n11 = (gradient_x[w + 1] * xs1 + gradient_y[w + 1] * ys1) + constant[w + 1];
+
+			float sx = CurveF(xs, m_quality), sy = CurveF(ys, m_quality);
+			float ix0 = n00 + (n10 - n00) * sx;
+			float ix1 = n01 + (n11 - n01) * sx;
+			value += (ix0 + (ix1 - ix0) * sy) * octave.amplitude;
+		}
+		r_values[p] = value;
+	}
+}
+
+#if defined(PERLIN_SLICE_AVX2)
+PERLIN_SLICE_TARGET void PerlinSlice::getValuesAVX2(const float * p_x, const float * p_y, float * r_values) const
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256 x = _mm256_loadu_ps(p_x), y = _mm256_loadu_ps(p_y);
+	__m256 value = _mm256_setzero_ps();
+	for (const Octave& octave : m_octaves)
+	{
+		__m256 frequency = _mm256_set1_ps(octave.frequency);
+		__m256 fx = _mm256_mul_ps(x, frequency), fy = _mm256_mul_ps(y, frequency);
+		__m256 x0 = _mm256_floor_ps(fx), y0 = _mm256_floor_ps(fy);
+		__m256 xs = _mm256_sub_ps(fx, x0), ys = _mm256_sub_ps(fy, y0);
+		__m256 xs1 = _mm256_sub_ps(xs, one), ys1 = _mm256_sub_ps(ys, one);
+
+		__m256i ix = _mm256_sub_epi32(_mm256_cvttps_epi32(x0), _mm256_set1_epi32(octave.origin_x));
+		__m256i iy = _mm256_sub_epi32(_mm256_cvttps_epi32(y0), _mm256_set1_epi32(octave.origin_y));
+		ix = _mm256_min_epi32(_mm256_max_epi32(ix, zero), _mm256_set1_epi32(octave.width - 2));
+		iy = _mm256_min_epi32(_mm256_max_epi32(iy, zero), _mm256_set1_epi32(octave.height - 2));
+		__m256i index = _mm256_add_epi32(_mm256_mullo_epi32(iy, _mm256_set1_epi32(octave.width)), ix);
+
+		const float * gradient_x = &m_gradient_x[octave.offset];
+		const float * gradient_y = &m_gradient_y[octave.offset];
+		const float * constant = &m_constant[octave.offset];
+		int w = octave.width;
+		__m256 n00 = GatherCorner(gradient_x, gradient_y, constant, index, xs, ys);
+		__m256 n10 = GatherCorner(gradient_x + 1, gradient_y + 1, constant + 1, index, xs1, ys);
+		__m256 n01 = GatherCorner(gradient_x + w, gradient_y + w, constant + w, index, xs, ys1);
+		__m256 n11 = GatherCorner(gradient_x + w + 1, gradient_y + w + 1, constant + w + 1, index, xs1, ys1);
+
+		__m256 sx, sy;
+		if (m_quality == noise::QUALITY_FAST)
+		{
+			sx = xs;
+			sy = ys;
+		}
+		else if (m_quality == noise::QUALITY_BEST)
+		{
+			const __m256 six = _mm256_set1_ps(6.0f), fifteen = _mm256_set1_ps(15.0f), ten = _mm256_set1_ps(10.0f);
+			sx = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xs, xs), xs), _mm256_add_ps(_mm256_mul_ps(xs, _mm256_sub_ps(_mm256_mul_ps(xs, six), fifteen)), ten));
+			sy = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(ys, ys), ys), _mm256_add_ps(_mm256_mul_ps(ys, _mm256_sub_ps(_mm256_mul_ps(ys, six), fifteen)), ten));
+		}
+		else
+		{
+			const __m256 three = _mm256_set1_ps(3.0f), two = _mm256_set1_ps(2.0f);
+			sx = _mm256_mul_ps(_mm256_mul_ps(xs, xs), _mm256_sub_ps(three, _mm256_mul_ps(two, xs)));
+			sy = _mm256_mul_ps(_mm256_mul_ps(ys, ys), _mm256_sub_ps(three, _mm256_mul_ps(two, ys)));
+		}
+
+		__m256 ix0 = _mm256_add_ps(n00, _mm256_mul_ps(_mm256_sub_ps(n10, n00), sx));
+		__m256 ix1 = _mm256_add_ps(n01, _mm256_mul_ps(_mm256_sub_ps(n11, n01), sx));
+		__m256 n = _mm256_add_ps(ix0, _mm256_mul_ps(_mm256_sub_ps(ix1, ix0), sy));
+		value = _mm256_add_ps(value, _mm256_mul_ps(n, _mm256_set1_ps(octave.amplitude)));
+	}
+	_mm256_storeu_ps(r_values, value);
+}
+#endif
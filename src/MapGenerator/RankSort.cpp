@@ -0,0 +1,140 @@
+#include "MapGenerator/RankSort.h"
+#include "MapGenerator/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Widest digit of a pass.
+static const unsigned int MAX_DIGIT_BITS = 13;
+// Fewer indices per thread than this aren't worth a block of their own.
+static const size_t MIN_BLOCK_SIZE = 16384;
+
+// Unsigned integer with the order of the value rounded to float: the sign
+// bit flipped for positive values, every bit for negative ones. -0 is the
+// same key as 0. Rounding never swaps two values, it can only make them equal.
+static inline uint32_t FloatKey(double p_value)
+{
+	float value = (float) p_value;
+	if (value == 0) value = 0;
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits >> 31) ? ~bits : bits | ((uint32_t) 1 << 31);
+}
+
+void RankSort(const std::vector<double>& p_keys, std::vector<unsigned int>& r_indices, ThreadPool& p_pool)
+{
+	size_t count = r_indices.size();
+	if (count < 2) return;
+
+	unsigned int block_count = (unsigned int) std::max<size_t>(1, std::min<size_t>(p_pool.GetThreadCount(), count / MIN_BLOCK_SIZE));
+	std::vector<size_t> block_begin(block_count + 1);
+	for (unsigned int b = 0; b <= block_count; b++)
+	{
+		block_begin[b] = count * b / block_count;
+	}
+
+	// The float key above the index.
+	std::vector<uint64_t> items(count), items_out(count);
+	std::vector<uint32_t> block_min(block_count), block_max(block_count);
+	p_pool.ParallelFor(0, block_count, 1, [&](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int b = p_begin; b < p_end; b++)
+		{
+			uint32_t min_key = 0xffffffff, max_key = 0;
+			for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++)
+			{
+				uint32_t key = FloatKey(p_keys[r_indices[i]]);
+				items[i] = (uint64_t) key << 32 | r_indices[i];
+				min_key = std::min(min_key, key);
+				max_key = std::max(max_key, key);
+			}
+			block_min[b] = min_key;
+			block_max[b] = max_key;
+		}
+	});
+	uint32_t min_key = *std::min_element(block_min.begin(), block_min.end());
+	uint32_t range = *std::max_element(block_max.begin(), block_max.end()) - min_key;
+
+	// Only the bits that differ between the smallest key and the largest are
+	// sorted, in as few passes as the widest digit allows.
+	unsigned int bits = 0;
+	while (bits < 32 && (range >> bits) != 0) bits++;
+	unsigned int pass_count = (bits + MAX_DIGIT_BITS - 1) / MAX_DIGIT_BITS;
+	unsigned int digit_bits = pass_count > 0 ? (bits + pass_count - 1) / pass_count : 0;
+	const size_t DIGIT_COUNT = (size_t) 1 << digit_bits;
+
+	std::vector<size_t> offsets(block_count * DIGIT_COUNT);
+	for (unsigned int shift = 32; shift < 32 + bits; shift += digit_bits)
+	{
+		p_pool.ParallelFor(0, block_count, 1, [&](unsigned int p_begin, unsigned int p_end)
+		{
+			for (unsigned int b = p_begin; b < p_end; b++)
+			{
+				size_t * histogram = &offsets[b * DIGIT_COUNT];
+				std::fill(histogram, histogram + DIGIT_COUNT, 0);
+				for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++)
+				{
+					if (shift == 32) items[i] -= (uint64_t) min_key << 32;
+					histogram[(items[i] >> shift) & (DIGIT_COUNT - 1)]++;
+				}
+			}
+		});
+
+		// Where every block starts writing each digit: all the smaller digits,
+		// then the same digit of the blocks before it.
+		size_t position = 0;
+		for (size_t d = 0; d < DIGIT_COUNT; d++)
+		{
+			for (unsigned int b = 0; b < block_count; b++)
+			{
+				size_t digit_count = offsets[b * DIGIT_COUNT + d];
+				offsets[b * DIGIT_COUNT + d] = position;
+				position += digit_count;
+			}
+		}
+
+		p_pool.ParallelFor(0, block_count, 1, [&](unsigned int p_begin, unsigned int p_end)
+		{
+			for (unsigned int b = p_begin; b < p_end; b++)
+			{
+				size_t * offset = &offsets[b * DIGIT_COUNT];
+				for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++)
+				{
+					items_out[offset[(items[i] >> shift) & (DIGIT_COUNT - 1)]++] = items[i];
+				}
+			}
+		});
+		items.swap(items_out);
+	}
+
+	// Runs of one float key hold values that are equal, or so close they
+	// rounded together; those are stable sorted by the value itself. A block
+	// takes the runs that start in it.
+	p_pool.ParallelFor(0, block_count, 1, [&](unsigned int p_begin, unsigned int p_end)
+	{
+		for (unsigned int b = p_begin; b < p_end; b++)
+		{
+			size_t i = block_begin[b];
+			while (i > 0 && i < count && (items[i] >> 32) == (items[i - 1] >> 32)) i++;
+			while (i < block_begin[b + 1])
+			{
+				size_t run_end = i + 1;
+				while (run_end < count && (items[run_end] >> 32) == (items[i] >> 32)) run_end++;
+
+				bool equal = true;
+				double value = run_end - i > 1 ? p_keys[(uint32_t) items[i]] : 0;
+				for (size_t k = i; k < run_end; k++)
+				{
+					r_indices[k] = (uint32_t) items[k];
+					equal = equal && (k == i || p_keys[r_indices[k]] == value);
+				}
+				if (!equal)
+				{
+					std::stable_sort(r_indices.begin() + i, r_indices.begin() + run_end, [&p_keys](unsigned int a, unsigned int c) { return p_keys[a] < p_keys[c]; });
+				}
+				i = run_end;
+			}
+		}
+	});
+}
@@ -0,0 +1,202 @@
+#include "MapGenerator/StageGraph.h"
+#include "MapGenerator/Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+StageGraph::StageGraph() : m_critical_time(0), m_wall_time(0)
+{
+}
+
+unsigned int StageGraph::Add(const std::string& p_name, DataSet p_reads, DataSet p_writes, const StageFunction& p_function)
+{
+	Stage stage;
+	stage.name = p_name;
+	stage.reads = p_reads;
+	stage.writes = p_writes;
+	stage.function = p_function;
+	stage.trace_name = Trace::Intern(p_name);
+	stage.run = false;
+	stage.ms = 0;
+	for (unsigned int s = 0; s < m_stages.size(); s++)
+	{
+		const Stage& earlier = m_stages[s];
+		if ((earlier.writes & (p_reads | p_writes)) || (earlier.reads & p_writes))
+			stage.dependencies.push_back(s);
+	}
+	m_stages.push_back(stage);
+	return (unsigned int) m_stages.size() - 1;
+}
+
+void StageGraph::Clear()
+{
+	m_stages.clear();
+	m_critical_path.clear();
+	m_critical_time = 0;
+	m_wall_time = 0;
+}
+
+void StageGraph::Run(unsigned int p_thread_count, const std::vector<unsigned int>& p_targets)
+{
+	unsigned int count = (unsigned int) m_stages.size();
+
+	// The targets and, walking back, everything they depend on. Dependencies
+	// are always earlier, so one backwards pass is enough.
+	std::vector<bool> selected(count, p_targets.empty());
+	for (unsigned int target : p_targets)
+		if (target < count) selected[target] = true;
+	for (unsigned int s = count; s-- > 0;)
+	{
+		m_stages[s].run = false;
+		m_stages[s].ms = 0;
+		if (!selected[s]) continue;
+		for (unsigned int d : m_stages[s].dependencies)
+			selected[d] = true;
+	}
+
+	// Stages waiting for others, and the ones each of them unblocks.
+	std::vector<unsigned int> waiting(count, 0);
+	std::vector<std::vector<unsigned int> > dependents(count);
+	std::vector<unsigned int> ready;
+	unsigned int left = 0;
+	for (unsigned int s = 0; s < count; s++)
+	{
+		if (!selected[s]) continue;
+		left++;
+		for (unsigned int d : m_stages[s].dependencies)
+		{
+			if (!selected[d]) continue;
+			waiting[s]++;
+			dependents[d].push_back(s);
+		}
+		if (waiting[s] == 0) ready.push_back(s);
+	}
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	double last_end = 0;
+
+	// Every thread takes the first ready stage in declaration order, so a
+	// single thread runs them in that order.
+	auto runStages = [&]()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			wake.wait(lock, [&] { return left == 0 || !ready.empty(); });
+			if (left == 0) return;
+
+			std::vector<unsigned int>::iterator first = std::min_element(ready.begin(), ready.end());
+			unsigned int s = *first;
+			ready.erase(first);
+			lock.unlock();
+
+			Clock::time_point stage_start = Clock::now();
+			{
+				TraceZone zone(m_stages[s].trace_name);
+				m_stages[s].function();
+			}
+			Clock::time_point stage_end = Clock::now();
+
+			lock.lock();
+			m_stages[s].run = true;
+			m_stages[s].ms = std::chrono::duration<double, std::milli>(stage_end - stage_start).count();
+			last_end = std::max(last_end, std::chrono::duration<double, std::milli>(stage_end - start).count());
+			left--;
+			for (unsigned int d : dependents[s])
+				if (--waiting[d] == 0) ready.push_back(d);
+			wake.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	unsigned int thread_count = std::max(1u, std::min(p_thread_count, left));
+	for (unsigned int t = 1; t < thread_count; t++)
+	{
+		threads.push_back(std::thread([&runStages, t]()
+		{
+			Trace::SetThreadName("Stage runner " + std::to_string(t));
+			runStages();
+		}));
+	}
+	runStages();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	m_wall_time = last_end;
+	findCriticalPath();
+}
+
+unsigned int StageGraph::GetStageCount() const
+{
+	return (unsigned int) m_stages.size();
+}
+
+const std::string& StageGraph::GetName(unsigned int p_stage) const
+{
+	return m_stages[p_stage].name;
+}
+
+bool StageGraph::WasRun(unsigned int p_stage) const
+{
+	return m_stages[p_stage].run;
+}
+
+double StageGraph::GetTime(unsigned int p_stage) const
+{
+	return m_stages[p_stage].ms;
+}
+
+const std::vector<unsigned int>& StageGraph::GetCriticalPath() const
+{
+	return m_critical_path;
+}
+
+double StageGraph::GetCriticalTime() const
+{
+	return m_critical_time;
+}
+
+double StageGraph::GetWallTime() const
+{
+	return m_wall_time;
+}
+
+// Longest chain by time, dependencies coming before the stages.
+void StageGraph::findCriticalPath()
+{
+	unsigned int count = (unsigned int) m_stages.size();
+	std::vector<double> finish(count, 0);
+	std::vector<unsigned int> previous(count, count);
+	unsigned int last = count;
+	m_critical_time = 0;
+	for (unsigned int s = 0; s < count; s++)
+	{
+		if (!m_stages[s].run) continue;
+		double begin = 0;
+		for (unsigned int d : m_stages[s].dependencies)
+		{
+			if (m_stages[d].run && finish[d] > begin)
+			{
+				begin = finish[d];
+				previous[s] = d;
+			}
+		}
+		finish[s] = begin + m_stages[s].ms;
+		if (last == count || finish[s] > m_critical_time)
+		{
+			last = s;
+			m_critical_time = finish[s];
+		}
+	}
+
+	m_critical_path.clear();
+	for (unsigned int s = last; s < count; s = previous[s])
+		m_critical_path.push_back(s);
+	std::reverse(m_critical_path.begin(), m_critical_path.end());
+}
@@ -1,5 +1,5 @@
 #include "MapGenerator/Structures.h"
-#include "MapGenerator/Math/LineEquation.h" 
+#include "MapGenerator/Math/Circumcenter.h"
 #include <iostream>
 
 edge::edge(unsigned int i, center *e1, center *e2, corner *o1, corner *o2) : index(i), d0(e1), d1(e2), v0(o1), v1(o2), river_volume(0.0) {
@@ -9,7 +9,7 @@ edge::edge(unsigned int i, center *e1, center *e2, corner *o1, corner *o2) : ind
 };
 
 bool center::RemoveEdge( edge *e ) {
-	std::vector<edge *>::iterator edge_iter;
+	NodeList<edge *>::iterator edge_iter;
 	for(edge_iter = edges.begin(); edge_iter != edges.end(); edge_iter++){
 		if(*edge_iter == e){
 			edges.erase(edge_iter);
@@ -20,7 +20,7 @@ bool center::RemoveEdge( edge *e ) {
 }
 
 edge * center::GetEdgeWith(center *ce){
-	std::vector<edge *>::iterator edge_iter;
+	NodeList<edge *>::iterator edge_iter;
 	for(edge_iter = edges.begin(); edge_iter != edges.end(); edge_iter++){
 		if((*edge_iter)->d0 == ce || (*edge_iter)->d1 == ce){
 			return *edge_iter;
@@ -30,7 +30,7 @@ edge * center::GetEdgeWith(center *ce){
 }
 
 bool center::RemoveCorner( corner *c ) {
-	std::vector<corner *>::iterator corner_iter, corners_end = corners.end();
+	NodeList<corner *>::iterator corner_iter, corners_end = corners.end();
 	for(corner_iter = corners.begin(); corner_iter != corners_end; corner_iter++){
 		if(*corner_iter == c){
 			corners.erase(corner_iter);
@@ -45,7 +45,7 @@ void center::MakeBorder(){
 	water = true;
 	ocean = true;
 
-	corner::PVIter corner_iter, corners_end = corners.end();
+	NodeList<corner *>::iterator corner_iter, corners_end = corners.end();
 	for(corner_iter = corners.begin(); corner_iter != corners_end; corner_iter++){
 		(*corner_iter)->border = true;
 		(*corner_iter)->water = true;
@@ -68,7 +68,7 @@ bool center::Contains(Vec2 p_pos){
 	Vec2 l_first_sec(corners[0]->position, corners[1]->position);
 	Vec2 l_first_pos(corners[0]->position, p_pos);
 	bool sign = l_first_sec.CrossProduct(l_first_pos) > 0;
-	corner::PVIter iter;
+	NodeList<corner *>::iterator iter;
 	for(iter = corners.begin() + 1; iter != corners.end() - 1; iter++){
 		Vec2 l_a_b((*iter)->position, (*(iter+1))->position);
 		Vec2 l_a_p((*iter)->position, p_pos);
@@ -84,7 +84,7 @@ std::pair<Vec2,Vec2> center::GetBoundingBox(){
 	double l_min_x = corners[0]->position.x, l_max_x = corners[0]->position.x;
 	double l_min_y = corners[0]->position.y, l_max_y = corners[0]->position.y;
 
-	corner::PVIter iter;
+	NodeList<corner *>::iterator iter;
 	for(iter = corners.begin() + 1; iter != corners.end(); iter++){
 		if ((*iter)->position.x < l_min_x) {
 			l_min_x = (*iter)->position.x;
@@ -120,14 +120,18 @@ void center::SortCorners(){
 }
 
 bool center::GoesBefore(Vec2 p_a, Vec2 p_b){
-	if((p_a - position).x >= 0 && (p_b - position).x < 0)
+	return GoesBefore(position, p_a, p_b);
+}
+
+bool center::GoesBefore(Vec2 p_center, Vec2 p_a, Vec2 p_b){
+	if((p_a - p_center).x >= 0 && (p_b - p_center).x < 0)
 		return true;
 
 	if(p_a.x == 0 && p_b.x == 0)
 		return p_a.y < p_b.y;
 
-	Vec2 ca(position, p_a);
-	Vec2 cb(position, p_b);
+	Vec2 ca(p_center, p_a);
+	Vec2 cb(p_center, p_b);
 	return ca.CrossProduct(cb) > 0;
 }
 
@@ -256,48 +260,17 @@ Vec2 corner::CalculateCircumcenter() {
 	if(this->centers.size() != 3)
 		return Vec2();
 
-	Vec2 a = centers[0]->position;
-	Vec2 b = centers[1]->position;
-	Vec2 c = centers[2]->position;
-	/*
-	double d = 2 * (a.x*(b.y - c.y) + b.x*(c.y - a.y) + c.x*(a.y - b.y));
-	double new_x = ((a.x*a.x + a.y*a.y)*(b.y - c.y) + (b.x*b.x + b.y*b.y)*(c.y - a.y) + (c.x*c.x + c.y*c.y)*(a.y - b.y)) / d;
-	double new_y = ((a.x*a.x + a.y*a.y)*(c.x - b.x) + (b.x*b.x + b.y*b.y)*(a.x - c.x) + (c.x*c.x + c.y*c.y)*(b.x - a.x)) / d;
-
-	return Vec2(new_x, new_y);*/
-
-
-	Vec2 ab_midpoint((a.x + b.x) / 2, (a.y + b.y) / 2);
-	equ ab_equ(a, b);
-
-	equ ab_bisector;
-	if(ab_equ.Vertical()){
-		ab_bisector = equ(ab_midpoint, Vec2(ab_midpoint.x + 1, ab_midpoint.y));
-	}else if(ab_equ.Horizontal()){
-		ab_bisector = equ(ab_midpoint, Vec2(ab_midpoint.x, ab_midpoint.y + 1));
-	}else{
-		double ab_bisector_slope = ab_equ.m == 0 ? 0 :  -1 / ab_equ.m;
-		ab_bisector = equ(ab_midpoint, ab_bisector_slope);
-	}
-
-	Vec2 bc_midpoint((b.x + c.x) / 2, (b.y + c.y) / 2);
-	equ bc_equ(b, c);
-
-	equ bc_bisector;
-	if(bc_equ.Vertical()){
-		bc_bisector = equ(bc_midpoint, Vec2(bc_midpoint.x + 1, bc_midpoint.y));
-	}else if(bc_equ.Horizontal()){
-		bc_bisector = equ(bc_midpoint, Vec2(bc_midpoint.x, bc_midpoint.y + 1));
-	}else{
-		double bc_bisector_slope = bc_equ.m == 0 ? 0 :  -1 / bc_equ.m;
-		bc_bisector = equ(bc_midpoint, bc_bisector_slope);
-	}
+	return Circumcenter(centers[0]->position, centers[1]->position, centers[2]->position);
+}
 
-	return ab_bisector.Intersection(bc_bisector);
+Vec2 corner::Circumcenter(Vec2 a, Vec2 b, Vec2 c) {
+	Vec2 result;
+	::Circumcenter(a.x, a.y, b.x, b.y, c.x, c.y, result.x, result.y);
+	return result;
 }
 
 center * corner::GetOpositeCenter( center *c0, center *c1 ) {
-	std::vector<center *>::iterator center_iter, centers_end = centers.end();
+	NodeList<center *>::iterator center_iter, centers_end = centers.end();
 	for(center_iter = centers.begin(); center_iter != centers_end; center_iter++){
 		if(*center_iter != c0 && *center_iter != c1)
 			return *center_iter;
@@ -333,7 +306,7 @@ bool corner::TouchesCenter( center *c ) {
 }
 
 edge * corner::GetEdgeConnecting( center *c0, center *c1 ) {
-	std::vector<edge *>::iterator edge_iter, edges_end = edges.end();
+	NodeList<edge *>::iterator edge_iter, edges_end = edges.end();
 	for(edge_iter = edges.begin(); edge_iter != edges_end; edge_iter++){
 		if(((*edge_iter)->d0 == c0 && (*edge_iter)->d1 == c1) || ((*edge_iter)->d1 == c0 && (*edge_iter)->d0 == c1) )
 			return *edge_iter;
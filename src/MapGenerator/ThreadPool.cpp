@@ -0,0 +1,177 @@
+#include "MapGenerator/ThreadPool.h"
+#include "MapGenerator/Trace.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int p_thread_count)
+{
+	m_thread_count = std::max(1u, p_thread_count);
+	m_generation = 0;
+	m_busy_workers = 0;
+	m_stop = false;
+	m_body = nullptr;
+	m_begin = m_end = m_grain = 0;
+	m_participants = 0;
+}
+
+ThreadPool::~ThreadPool()
+{
+	stopWorkers();
+}
+
+void ThreadPool::SetThreadCount(unsigned int p_thread_count)
+{
+	p_thread_count = std::max(1u, p_thread_count);
+	if (p_thread_count != m_thread_count)
+	{
+		stopWorkers();
+		m_thread_count = p_thread_count;
+	}
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return m_thread_count;
+}
+
+void ThreadPool::ParallelFor(unsigned int p_begin, unsigned int p_end, unsigned int p_grain, const RangeFunction& p_body)
+{
+	if (p_end <= p_begin) return;
+	p_grain = std::max(1u, p_grain);
+	unsigned int chunk_count = (p_end - p_begin - 1) / p_grain + 1;
+
+	// Small loops, or a single thread, aren't worth waking anybody.
+	if (m_thread_count == 1 || chunk_count == 1)
+	{
+		p_body(p_begin, p_end);
+		return;
+	}
+
+	std::unique_lock<std::mutex> loop(m_loop_mutex, std::try_to_lock);
+	if (!loop.owns_lock())
+	{
+		p_body(p_begin, p_end);
+		return;
+	}
+
+	if (m_workers.empty()) startWorkers();
+
+	unsigned int participants = std::min(m_thread_count, chunk_count);
+	for (unsigned int t = 0; t < participants; t++)
+	{
+		m_queues[t].front = (unsigned int) ((unsigned long long) chunk_count * t / participants);
+		m_queues[t].back = (unsigned int) ((unsigned long long) chunk_count * (t + 1) / participants);
+	}
+	for (unsigned int t = participants; t < m_thread_count; t++)
+	{
+		m_queues[t].front = m_queues[t].back = 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_body = &p_body;
+		m_begin = p_begin;
+		m_end = p_end;
+		m_grain = p_grain;
+		m_participants = participants;
+		m_busy_workers = (unsigned int) m_workers.size();
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	runChunks(0);
+
+	// The workers may still be finishing chunks they took, and mustn't see
+	// the next loop before they are all back to sleep.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busy_workers == 0; });
+	m_body = nullptr;
+}
+
+void ThreadPool::startWorkers()
+{
+	m_queues.reset(new Queue[m_thread_count]);
+	m_stop = false;
+	for (unsigned int t = 1; t < m_thread_count; t++)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::workerLoop, this, t, m_generation));
+	}
+}
+
+void ThreadPool::stopWorkers()
+{
+	if (m_workers.empty()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+// p_generation is the last loop before the worker started, so a loop that
+// begins while it is still starting up isn't missed.
+void ThreadPool::workerLoop(unsigned int p_index, unsigned long long p_generation)
+{
+	Trace::SetThreadName("Pool worker " + std::to_string(p_index));
+
+	unsigned long long seen = p_generation;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+			if (m_stop) return;
+			seen = m_generation;
+		}
+
+		runChunks(p_index);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy_workers == 0) m_done.notify_one();
+	}
+}
+
+void ThreadPool::runChunks(unsigned int p_index)
+{
+	TraceZone zone("Pool loop");
+	unsigned int chunk;
+	while (takeChunk(p_index, chunk))
+	{
+		unsigned int begin = m_begin + chunk * m_grain;
+		unsigned int end = std::min(m_end, begin + m_grain);
+		(*m_body)(begin, end);
+	}
+}
+
+bool ThreadPool::takeChunk(unsigned int p_index, unsigned int& r_chunk)
+{
+	// Own run first, from the front.
+	if (p_index < m_participants)
+	{
+		Queue& own = m_queues[p_index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.front < own.back)
+		{
+			r_chunk = own.front++;
+			return true;
+		}
+	}
+
+	// Then the others', from the back, starting with the next thread.
+	for (unsigned int i = 1; i < m_thread_count; i++)
+	{
+		Queue& victim = m_queues[(p_index + i) % m_thread_count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.front < victim.back)
+		{
+			r_chunk = --victim.back;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,179 @@
+#include "MapGenerator/Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// Zones kept per thread.
+static const size_t RING_SIZE = 1 << 14;
+
+namespace
+{
+	struct Zone
+	{
+		const char * name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	// Written by its thread only; head counts the zones ever recorded, and
+	// is published after the zone it counts.
+	struct ThreadBuffer
+	{
+		unsigned int id;
+		std::string name;
+		std::atomic<uint64_t> head;
+		Zone zones[RING_SIZE];
+	};
+
+	// Buffers outlive their threads, so the zones of a finished worker are
+	// still written. The buffer of a finished thread goes to the next new
+	// one, which goes on with its track, so threads started over and over,
+	// as the stage runners, don't add a buffer each.
+	std::mutex g_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer> > g_buffers;
+	std::vector<ThreadBuffer *> g_free_buffers;
+	std::set<std::string> g_names;
+
+	// The buffer of a thread, made on its first zone, and the name of the
+	// thread, kept until then.
+	struct BufferOwner
+	{
+		ThreadBuffer * buffer;
+		std::string name;
+
+		BufferOwner() : buffer(nullptr) {}
+		~BufferOwner()
+		{
+			if (!buffer) return;
+			std::lock_guard<std::mutex> lock(g_mutex);
+			g_free_buffers.push_back(buffer);
+		}
+	};
+
+	thread_local BufferOwner t_owner;
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (!t_owner.buffer)
+		{
+			std::lock_guard<std::mutex> lock(g_mutex);
+			if (!g_free_buffers.empty())
+			{
+				t_owner.buffer = g_free_buffers.back();
+				g_free_buffers.pop_back();
+			}
+			else
+			{
+				g_buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+				t_owner.buffer = g_buffers.back().get();
+				t_owner.buffer->id = (unsigned int) g_buffers.size();
+				t_owner.buffer->head.store(0, std::memory_order_relaxed);
+			}
+			t_owner.buffer->name = t_owner.name.empty() ? "Thread " + std::to_string(t_owner.buffer->id) : t_owner.name;
+		}
+		return *t_owner.buffer;
+	}
+
+	void WriteString(FILE * p_file, const char * p_text)
+	{
+		fputc('"', p_file);
+		for (; *p_text; p_text++)
+		{
+			if (*p_text == '"' || *p_text == '\\') fputc('\\', p_file);
+			fputc(*p_text, p_file);
+		}
+		fputc('"', p_file);
+	}
+}
+
+std::atomic<bool> Trace::s_enabled(false);
+
+void Trace::SetEnabled(bool p_enabled)
+{
+	Now();
+	s_enabled.store(p_enabled, std::memory_order_relaxed);
+}
+
+void Trace::SetThreadName(const std::string& p_name)
+{
+	t_owner.name = p_name;
+	if (!t_owner.buffer) return;
+	std::lock_guard<std::mutex> lock(g_mutex);
+	t_owner.buffer->name = p_name;
+}
+
+const char * Trace::Intern(const std::string& p_name)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	return g_names.insert(p_name).first->c_str();
+}
+
+uint64_t Trace::Now()
+{
+	static const std::chrono::steady_clock::time_point EPOCH = std::chrono::steady_clock::now();
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - EPOCH).count();
+}
+
+void Trace::Record(const char * p_name, uint64_t p_start, uint64_t p_end)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	Zone& zone = buffer.zones[head % RING_SIZE];
+	zone.name = p_name;
+	zone.start = p_start;
+	zone.end = p_end;
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool Trace::Write(const std::string& p_file_name)
+{
+	FILE * file = fopen(p_file_name.c_str(), "w");
+	if (!file) return false;
+
+	std::lock_guard<std::mutex> lock(g_mutex);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+	for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers)
+	{
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",", buffer->id);
+		WriteString(file, buffer->name.c_str());
+		fprintf(file, "}}");
+		first = false;
+
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		for (uint64_t i = head > RING_SIZE ? head - RING_SIZE : 0; i < head; i++)
+		{
+			const Zone& zone = buffer->zones[i % RING_SIZE];
+			fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+			WriteString(file, zone.name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				buffer->id, zone.start / 1000.0, (zone.end - zone.start) / 1000.0);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+void Trace::Clear()
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers)
+		buffer->head.store(0, std::memory_order_relaxed);
+}
+
+size_t Trace::GetZoneCount()
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	size_t count = 0;
+	for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers)
+	{
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		count += (size_t) (head > RING_SIZE ? RING_SIZE : head);
+	}
+	return count;
+}
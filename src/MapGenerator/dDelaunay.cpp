@@ -307,14 +307,13 @@ void Delaunay::Triangulate(const vertexSet& vertices, triangleSet& output)
 
 	// Finally, remove all the triangles belonging to the 'super triangle' and move the remaining
 	// triangles tot the output; remove_copy_if lets us do that in one go.
-	tIterator where = output.begin();
 	triangleHasVertex pred(vSuper);
 	for(const triangle& t : workset) {
 		if(!pred(t)){
 			output.insert(output.begin(), t);
 		}
 	}
-	//remove_copy_if(workset.begin(), workset.end(), inserter(output, where), triangleHasVertex(vSuper));
+	//remove_copy_if(workset.begin(), workset.end(), inserter(output, output.begin()), triangleHasVertex(vSuper));
 }
 
 void Delaunay::TrianglesToEdges(const triangleSet& triangles, edgeSet& edges)
@@ -0,0 +1,122 @@
+#include "MapGenerator/dSpatialSort.h"
+#include <algorithm>
+#include <utility>
+
+namespace del {
+
+static const unsigned int HILBERT_BITS = 16;
+
+unsigned long long HilbertIndex(unsigned int x, unsigned int y, unsigned int bits)
+{
+	unsigned long long d = 0;
+	for (unsigned int s = 1u << (bits - 1); s > 0; s >>= 1)
+	{
+		unsigned int rx = (x & s) > 0;
+		unsigned int ry = (y & s) > 0;
+		d += (unsigned long long) s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant so the curve stays continuous.
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+// Sorts vertices[begin, end) along the Hilbert curve over the given bounding box.
+static void HilbertSortRange(std::vector<vertex>& vertices, size_t begin, size_t end,
+	REAL x_min, REAL y_min, REAL size)
+{
+	double scale = ((1u << HILBERT_BITS) - 1) / (double) size;
+
+	std::vector<std::pair<unsigned long long, vertex> > keyed;
+	keyed.reserve(end - begin);
+	for (size_t i = begin; i < end; i++)
+	{
+		unsigned int x = (unsigned int) ((vertices[i].GetX() - x_min) * scale);
+		unsigned int y = (unsigned int) ((vertices[i].GetY() - y_min) * scale);
+		keyed.push_back(std::make_pair(HilbertIndex(x, y, HILBERT_BITS), vertices[i]));
+	}
+
+	std::stable_sort(keyed.begin(), keyed.end(),
+		[](const std::pair<unsigned long long, vertex>& a, const std::pair<unsigned long long, vertex>& b) { return a.first < b.first; });
+
+	for (size_t i = begin; i < end; i++)
+		vertices[i] = keyed[i - begin].second;
+}
+
+static void BoundingSquare(const std::vector<vertex>& vertices, REAL& r_x_min, REAL& r_y_min, REAL& r_size)
+{
+	REAL x_min = vertices[0].GetX(), x_max = x_min;
+	REAL y_min = vertices[0].GetY(), y_max = y_min;
+	for (const vertex& v : vertices)
+	{
+		x_min = std::min(x_min, v.GetX());
+		x_max = std::max(x_max, v.GetX());
+		y_min = std::min(y_min, v.GetY());
+		y_max = std::max(y_max, v.GetY());
+	}
+	r_x_min = x_min;
+	r_y_min = y_min;
+	r_size = std::max(std::max(x_max - x_min, y_max - y_min), REAL_EPSILON);
+}
+
+void HilbertSort(std::vector<vertex>& vertices)
+{
+	if (vertices.size() < 2) return;
+
+	REAL x_min, y_min, size;
+	BoundingSquare(vertices, x_min, y_min, size);
+	HilbertSortRange(vertices, 0, vertices.size(), x_min, y_min, size);
+}
+
+void BrioSort(std::vector<vertex>& vertices, unsigned int seed)
+{
+	if (vertices.size() < 2) return;
+
+	REAL x_min, y_min, size;
+	BoundingSquare(vertices, x_min, y_min, size);
+
+	// Each vertex survives to the next round with probability 1/2, so the last
+	// round holds about half of them. The coin flips are the bits of a hash of
+	// (seed, index), which makes the order reproducible.
+	unsigned int round_count = 1;
+	while ((1ull << round_count) < vertices.size()) round_count++;
+
+	std::vector<std::pair<unsigned int, vertex> > by_round;
+	by_round.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		unsigned int h = (unsigned int) i * 0x9E3779B9u ^ seed;
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+
+		unsigned int round = 0;
+		while (round + 1 < round_count && (h & (1u << round)) == 0) round++;
+		by_round.push_back(std::make_pair(round_count - 1 - round, vertices[i]));
+	}
+
+	std::stable_sort(by_round.begin(), by_round.end(),
+		[](const std::pair<unsigned int, vertex>& a, const std::pair<unsigned int, vertex>& b) { return a.first < b.first; });
+
+	size_t begin = 0;
+	for (size_t i = 0; i <= by_round.size(); i++)
+	{
+		if (i < by_round.size() && by_round[i].first == by_round[begin].first) continue;
+		for (size_t j = begin; j < i; j++)
+			vertices[j] = by_round[j].second;
+		HilbertSortRange(vertices, begin, i, x_min, y_min, size);
+		begin = i;
+	}
+}
+
+}
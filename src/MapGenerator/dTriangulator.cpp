@@ -0,0 +1,755 @@
+#include "MapGenerator/dTriangulator.h"
+#include "MapGenerator/Math/Circumcenter.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+namespace del {
+
+const unsigned int Triangulator::INVALID_INDEX;
+
+// Below this many points per strip the stitching isn't worth it.
+static const unsigned int MIN_STRIP_POINTS = 4096;
+
+// Circumcircle of the triangle (a, b, c), false if the points are collinear.
+static bool CircumCircle(const double * a, const double * b, const double * c,
+	double& r_x, double& r_y, double& r_radius)
+{
+	if ((b[0] - a[0]) * (c[1] - a[1]) == (b[1] - a[1]) * (c[0] - a[0])) return false;
+
+	Circumcenter(a[0], a[1], b[0], b[1], c[0], c[1], r_x, r_y);
+	r_radius = std::sqrt((r_x - a[0]) * (r_x - a[0]) + (r_y - a[1]) * (r_y - a[1]));
+	return true;
+}
+
+Triangulator::Triangulator() : m_VertexCount(0), m_Last(0), m_WalkState(1), m_ThreadCount(1),
+	m_GridSize(0), m_GridMinX(0), m_GridMinY(0), m_GridScale(0)
+{
+}
+
+void Triangulator::Triangulate(const std::vector<vertex>& vertices)
+{
+	m_VertexCount = (unsigned int) vertices.size();
+	m_Coords.resize(2 * (m_VertexCount + 3));
+	for (unsigned int i = 0; i < m_VertexCount; i++)
+	{
+		m_Coords[2 * i] = vertices[i].GetX();
+		m_Coords[2 * i + 1] = vertices[i].GetY();
+	}
+	Compute();
+}
+
+void Triangulator::Triangulate(const vertexSet& vertices, triangleSet& output)
+{
+	std::vector<const vertex *> pointers;
+	pointers.reserve(vertices.size());
+	m_VertexCount = (unsigned int) vertices.size();
+	m_Coords.resize(2 * (m_VertexCount + 3));
+	for (cvIterator it = vertices.begin(); it != vertices.end(); it++)
+	{
+		m_Coords[2 * pointers.size()] = it->GetX();
+		m_Coords[2 * pointers.size() + 1] = it->GetY();
+		pointers.push_back(& (* it));
+	}
+	Compute();
+
+	for (size_t t = 0; t < m_Triangles.size(); t += 3)
+		output.insert(triangle(pointers[m_Triangles[t]], pointers[m_Triangles[t + 1]], pointers[m_Triangles[t + 2]]));
+}
+
+void Triangulator::Compute()
+{
+	m_Ranks.clear();
+	if (m_ThreadCount > 1 && m_VertexCount >= MIN_STRIP_POINTS * m_ThreadCount)
+		RunParallel();
+	else
+		Run();
+	Canonicalize();
+
+	m_Circumcenters.resize(2 * GetTriangleCount());
+	Circumcenters(m_Coords.data(), m_Triangles.data(), GetTriangleCount(), m_Circumcenters.data());
+}
+
+void Triangulator::Run()
+{
+	m_Triangles.clear();
+	m_Halfedges.clear();
+	m_Stack.clear();
+	if (m_VertexCount < 3) return;	// nothing to handle
+
+	// Every point adds two triangles, plus the super triangle itself.
+	m_Triangles.reserve(3 * (2 * m_VertexCount + 1));
+	m_Halfedges.reserve(3 * (2 * m_VertexCount + 1));
+
+	AddSuperTriangle();
+
+	for (unsigned int p = 0; p < m_VertexCount; p++)
+	{
+		unsigned int e;
+		switch (Locate(p, e))
+		{
+		case Inside:
+			SplitTriangle(e / 3, p);
+			break;
+		case OnEdge:
+			SplitEdge(e, p);
+			break;
+		case OnVertex:	// Repeated vertex, it's already in the triangulation.
+			continue;
+		}
+		SetHint(p, m_Last);
+	}
+
+	RemoveSuperTriangle();
+}
+
+void Triangulator::AddSuperTriangle()
+{
+	double x_min = m_Coords[0], x_max = m_Coords[0];
+	double y_min = m_Coords[1], y_max = m_Coords[1];
+	for (unsigned int i = 1; i < m_VertexCount; i++)
+	{
+		x_min = std::min(x_min, m_Coords[2 * i]);
+		x_max = std::max(x_max, m_Coords[2 * i]);
+		y_min = std::min(y_min, m_Coords[2 * i + 1]);
+		y_max = std::max(y_max, m_Coords[2 * i + 1]);
+	}
+
+	// The walk needs every point strictly inside the super triangle. Far away
+	// vertices keep the hull close to the real convex hull, but too far away
+	// and the predicates lose precision.
+	double size = std::max(std::max(x_max - x_min, y_max - y_min), 1.0) * 32;
+	double center_x = (x_min + x_max) * 0.5;
+	double center_y = (y_min + y_max) * 0.5;
+
+	unsigned int s = m_VertexCount;
+	m_Coords[2 * s] = center_x - size;
+	m_Coords[2 * s + 1] = center_y - size;
+	m_Coords[2 * s + 2] = center_x + size;
+	m_Coords[2 * s + 3] = center_y - size;
+	m_Coords[2 * s + 4] = center_x;
+	m_Coords[2 * s + 5] = center_y + size;
+
+	m_Last = AddTriangle(s, s + 1, s + 2);
+
+	// About four points per cell is enough to keep the walks short whatever
+	// the insertion order is.
+	m_GridSize = std::max(1u, (unsigned int) std::sqrt(m_VertexCount / 4.0));
+	m_GridMinX = x_min;
+	m_GridMinY = y_min;
+	m_GridScale = m_GridSize / (std::max(std::max(x_max - x_min, y_max - y_min), 1.0) * 1.0001);
+
+	m_GridLevels.clear();
+	unsigned int cells = 0;
+	for (unsigned int level_size = m_GridSize; ; level_size = (level_size + 1) / 2)
+	{
+		m_GridLevels.push_back(cells);
+		cells += level_size * level_size;
+		if (level_size == 1) break;
+	}
+	m_Grid.assign(cells, INVALID_INDEX);
+}
+
+void Triangulator::GridCell(unsigned int p, unsigned int& r_x, unsigned int& r_y) const
+{
+	r_x = std::min((unsigned int) ((m_Coords[2 * p] - m_GridMinX) * m_GridScale), m_GridSize - 1);
+	r_y = std::min((unsigned int) ((m_Coords[2 * p + 1] - m_GridMinY) * m_GridScale), m_GridSize - 1);
+}
+
+unsigned int Triangulator::GetHint(unsigned int p) const
+{
+	unsigned int x, y;
+	GridCell(p, x, y);
+	unsigned int level_size = m_GridSize;
+	for (size_t level = 0; level < m_GridLevels.size(); level++)
+	{
+		unsigned int hint = m_Grid[m_GridLevels[level] + (y >> level) * level_size + (x >> level)];
+		if (hint != INVALID_INDEX) return hint;
+		level_size = (level_size + 1) / 2;
+	}
+	return m_Last;
+}
+
+void Triangulator::SetHint(unsigned int p, unsigned int e)
+{
+	unsigned int x, y;
+	GridCell(p, x, y);
+	unsigned int level_size = m_GridSize;
+	for (size_t level = 0; level < m_GridLevels.size(); level++)
+	{
+		m_Grid[m_GridLevels[level] + (y >> level) * level_size + (x >> level)] = e;
+		level_size = (level_size + 1) / 2;
+	}
+}
+
+void Triangulator::RemoveSuperTriangle()
+{
+	// Compact the triangles that don't touch the super triangle and remap
+	// the half-edges; the ones that pointed to a removed triangle are the hull.
+	std::vector<unsigned int> new_index(m_Triangles.size() / 3, INVALID_INDEX);
+	unsigned int triangle_count = 0;
+	for (size_t t = 0; t < new_index.size(); t++)
+	{
+		if (m_Triangles[3 * t] < m_VertexCount && m_Triangles[3 * t + 1] < m_VertexCount && m_Triangles[3 * t + 2] < m_VertexCount)
+			new_index[t] = triangle_count++;
+	}
+
+	for (size_t t = 0; t < new_index.size(); t++)
+	{
+		if (new_index[t] == INVALID_INDEX) continue;
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int e = 3 * new_index[t] + k;
+			unsigned int twin = m_Halfedges[3 * t + k];
+			m_Triangles[e] = m_Triangles[3 * t + k];
+			if (twin == INVALID_INDEX || new_index[twin / 3] == INVALID_INDEX)
+				m_Halfedges[e] = INVALID_INDEX;
+			else
+				m_Halfedges[e] = 3 * new_index[twin / 3] + twin % 3;
+		}
+	}
+
+	m_Triangles.resize(3 * triangle_count);
+	m_Halfedges.resize(3 * triangle_count);
+}
+
+void Triangulator::RunParallel()
+{
+	// Every strip is triangulated on its own. A triangle whose circumcircle
+	// stays inside its strip (and inside the bounding box, away from the super
+	// triangle) can't be affected by any other point, so it's final. The
+	// vertices of the other triangles and of the strip hulls form the seams,
+	// which are triangulated once more; from that triangulation we keep the
+	// triangles whose circumcircle is empty of the remaining points.
+	unsigned int n = m_VertexCount;
+	unsigned int strip_count = m_ThreadCount;
+
+	double x_min = m_Coords[0], x_max = m_Coords[0];
+	double y_min = m_Coords[1], y_max = m_Coords[1];
+	for (unsigned int i = 1; i < n; i++)
+	{
+		x_min = std::min(x_min, m_Coords[2 * i]);
+		x_max = std::max(x_max, m_Coords[2 * i]);
+		y_min = std::min(y_min, m_Coords[2 * i + 1]);
+		y_max = std::max(y_max, m_Coords[2 * i + 1]);
+	}
+	double scale = std::max(std::max(x_max - x_min, y_max - y_min), 1.0);
+
+	// Strip j holds the points with bounds[j - 1] <= x < bounds[j], so repeated
+	// points always share a strip.
+	std::vector<double> bounds;
+	{
+		std::vector<double> xs(n);
+		for (unsigned int i = 0; i < n; i++)
+			xs[i] = m_Coords[2 * i];
+		size_t previous = 0;
+		for (unsigned int j = 1; j < strip_count; j++)
+		{
+			size_t k = (size_t) n * j / strip_count;
+			std::nth_element(xs.begin() + previous, xs.begin() + k, xs.end());
+			bounds.push_back(xs[k]);
+			previous = k;
+		}
+	}
+
+	std::vector<std::vector<unsigned int> > strips(strip_count);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		size_t j = std::upper_bound(bounds.begin(), bounds.end(), m_Coords[2 * i]) - bounds.begin();
+		strips[j].push_back(i);
+	}
+
+	std::vector<std::vector<unsigned int> > finals(strip_count);
+	std::vector<unsigned char> in_seam(n, 0);
+
+	std::vector<std::thread> workers;
+	for (unsigned int j = 0; j < strip_count; j++)
+	{
+		workers.push_back(std::thread([&, j]()
+		{
+			const std::vector<unsigned int>& members = strips[j];
+			if (members.empty()) return;
+
+			Triangulator strip;
+			strip.m_VertexCount = (unsigned int) members.size();
+			strip.m_Coords.resize(2 * (members.size() + 3));
+			for (size_t i = 0; i < members.size(); i++)
+			{
+				strip.m_Coords[2 * i] = m_Coords[2 * members[i]];
+				strip.m_Coords[2 * i + 1] = m_Coords[2 * members[i] + 1];
+			}
+			strip.m_Ranks = members;
+			strip.Run();
+
+			double lo = j == 0 ? x_min : std::max(x_min, bounds[j - 1]);
+			double hi = j == strip_count - 1 ? x_max : std::min(x_max, bounds[j]);
+			const std::vector<unsigned int>& tris = strip.m_Triangles;
+			for (size_t e = 0; e < tris.size(); e += 3)
+			{
+				unsigned int a = members[tris[e]];
+				unsigned int b = members[tris[e + 1]];
+				unsigned int c = members[tris[e + 2]];
+
+				double cx, cy, radius;
+				bool final = CircumCircle(&m_Coords[2 * a], &m_Coords[2 * b], &m_Coords[2 * c], cx, cy, radius);
+				if (final)
+				{
+					double reach = radius * (1 + 1e-9) + scale * 1e-12;
+					final = cx - reach > lo && cx + reach < hi && cy - reach > y_min && cy + reach < y_max;
+				}
+
+				if (final)
+				{
+					finals[j].push_back(a);
+					finals[j].push_back(b);
+					finals[j].push_back(c);
+				}
+				else
+				{
+					in_seam[a] = in_seam[b] = in_seam[c] = 1;
+				}
+			}
+			for (size_t e = 0; e < tris.size(); e++)
+			{
+				if (strip.m_Halfedges[e] == INVALID_INDEX)
+					in_seam[members[tris[e]]] = 1;
+			}
+		}));
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+
+	// Triangulate the seams with the same super triangle as the serial version.
+	std::vector<unsigned int> seam;
+	for (unsigned int i = 0; i < n; i++)
+		if (in_seam[i]) seam.push_back(i);
+
+	Triangulator merge;
+	merge.m_VertexCount = (unsigned int) seam.size();
+	merge.m_Coords.resize(2 * (seam.size() + 3));
+	for (size_t i = 0; i < seam.size(); i++)
+	{
+		merge.m_Coords[2 * i] = m_Coords[2 * seam[i]];
+		merge.m_Coords[2 * i + 1] = m_Coords[2 * seam[i] + 1];
+	}
+	merge.m_Ranks = seam;
+	merge.Run();
+
+	// Final triangles made only of seam vertices may also come out of the
+	// seam triangulation; those must not be added twice.
+	std::vector<std::array<unsigned int, 3> > shared_finals;
+	std::vector<unsigned char> used(n, 0);
+	for (unsigned int j = 0; j < strip_count; j++)
+	{
+		for (size_t e = 0; e < finals[j].size(); e += 3)
+		{
+			unsigned int a = finals[j][e], b = finals[j][e + 1], c = finals[j][e + 2];
+			used[a] = used[b] = used[c] = 1;
+			if (in_seam[a] && in_seam[b] && in_seam[c])
+			{
+				std::array<unsigned int, 3> key = {{ a, b, c }};
+				std::rotate(key.begin(), std::min_element(key.begin(), key.end()), key.end());
+				shared_finals.push_back(key);
+			}
+		}
+	}
+	std::sort(shared_finals.begin(), shared_finals.end());
+
+	// Bucket the points that only appear in final triangles; repeated points
+	// appear in no triangle at all and must not count as conflicts.
+	std::vector<unsigned int> inner;
+	for (unsigned int i = 0; i < n; i++)
+		if (used[i] && !in_seam[i]) inner.push_back(i);
+
+	unsigned int grid_size = std::max(1u, (unsigned int) std::sqrt(inner.size() / 4.0));
+	double grid_scale = grid_size / (scale * 1.0001);
+	std::vector<unsigned int> cell_start(grid_size * grid_size + 1, 0);
+	std::vector<unsigned int> cell_points(inner.size());
+	std::vector<unsigned int> inner_cell(inner.size());
+	for (size_t i = 0; i < inner.size(); i++)
+	{
+		unsigned int cx = std::min((unsigned int) ((m_Coords[2 * inner[i]] - x_min) * grid_scale), grid_size - 1);
+		unsigned int cy = std::min((unsigned int) ((m_Coords[2 * inner[i] + 1] - y_min) * grid_scale), grid_size - 1);
+		inner_cell[i] = cy * grid_size + cx;
+		cell_start[inner_cell[i] + 1]++;
+	}
+	for (size_t c = 1; c < cell_start.size(); c++)
+		cell_start[c] += cell_start[c - 1];
+	{
+		std::vector<unsigned int> cursor(cell_start.begin(), cell_start.end() - 1);
+		for (size_t i = 0; i < inner.size(); i++)
+			cell_points[cursor[inner_cell[i]]++] = inner[i];
+	}
+
+	const std::vector<unsigned int>& merged = merge.m_Triangles;
+	std::vector<unsigned char> keep(merged.size() / 3, 0);
+	for (unsigned int w = 0; w < strip_count; w++)
+	{
+		workers.push_back(std::thread([&, w]()
+		{
+			size_t begin = keep.size() * w / strip_count;
+			size_t end = keep.size() * (w + 1) / strip_count;
+			for (size_t t = begin; t < end; t++)
+			{
+				unsigned int a = seam[merged[3 * t]];
+				unsigned int b = seam[merged[3 * t + 1]];
+				unsigned int c = seam[merged[3 * t + 2]];
+
+				std::array<unsigned int, 3> key = {{ a, b, c }};
+				std::rotate(key.begin(), std::min_element(key.begin(), key.end()), key.end());
+				if (std::binary_search(shared_finals.begin(), shared_finals.end(), key)) continue;
+
+				double cx, cy, radius;
+				if (!CircumCircle(&m_Coords[2 * a], &m_Coords[2 * b], &m_Coords[2 * c], cx, cy, radius)) continue;
+
+				// Any point strictly inside (or on, as decided by the
+				// perturbation) rules the triangle out. The cell holding the
+				// center goes first, it settles the big circles right away.
+				double reach = radius * (1 + 1e-9) + scale * 1e-12;
+				int x0 = std::max(0, (int) std::floor((cx - reach - x_min) * grid_scale));
+				int x1 = std::min((int) grid_size - 1, (int) std::floor((cx + reach - x_min) * grid_scale));
+				int y0 = std::max(0, (int) std::floor((cy - reach - y_min) * grid_scale));
+				int y1 = std::min((int) grid_size - 1, (int) std::floor((cy + reach - y_min) * grid_scale));
+				if (x0 > x1 || y0 > y1)
+				{
+					keep[t] = 1;
+					continue;
+				}
+				int center_x = std::min(std::max((int) std::floor((cx - x_min) * grid_scale), x0), x1);
+				int center_y = std::min(std::max((int) std::floor((cy - y_min) * grid_scale), y0), y1);
+
+				bool empty = true;
+				unsigned int center_cell = center_y * grid_size + center_x;
+				for (unsigned int k = cell_start[center_cell]; k < cell_start[center_cell + 1] && empty; k++)
+					empty = !InCircle(a, b, c, cell_points[k]);
+				for (int y = y0; y <= y1 && empty; y++)
+				{
+					for (int x = x0; x <= x1 && empty; x++)
+					{
+						unsigned int cell = y * grid_size + x;
+						if (cell == center_cell) continue;
+						for (unsigned int k = cell_start[cell]; k < cell_start[cell + 1] && empty; k++)
+							empty = !InCircle(a, b, c, cell_points[k]);
+					}
+				}
+				keep[t] = empty;
+			}
+		}));
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+
+	m_Triangles.clear();
+	for (unsigned int j = 0; j < strip_count; j++)
+		m_Triangles.insert(m_Triangles.end(), finals[j].begin(), finals[j].end());
+	for (size_t t = 0; t < keep.size(); t++)
+	{
+		if (!keep[t]) continue;
+		m_Triangles.push_back(seam[merged[3 * t]]);
+		m_Triangles.push_back(seam[merged[3 * t + 1]]);
+		m_Triangles.push_back(seam[merged[3 * t + 2]]);
+	}
+	m_Halfedges.assign(m_Triangles.size(), INVALID_INDEX);	// rebuilt by Canonicalize
+}
+
+void Triangulator::Canonicalize()
+{
+	// Rotate every triangle so its smallest vertex goes first and sort them
+	// by that vertex, then by the second one. The half-edges are rebuilt by
+	// matching a->b with b->a among the half-edges leaving b.
+	size_t triangle_count = m_Triangles.size() / 3;
+	std::vector<unsigned int> start(m_VertexCount + 1, 0);
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		unsigned int * tri = & m_Triangles[3 * t];
+		std::rotate(tri, std::min_element(tri, tri + 3), tri + 3);
+		start[tri[0] + 1]++;
+	}
+	for (size_t v = 1; v < start.size(); v++)
+		start[v] += start[v - 1];
+
+	std::vector<unsigned int> sorted(m_Triangles.size());
+	{
+		std::vector<unsigned int> cursor(start.begin(), start.end() - 1);
+		for (size_t t = 0; t < triangle_count; t++)
+		{
+			unsigned int dst = 3 * cursor[m_Triangles[3 * t]]++;
+			sorted[dst] = m_Triangles[3 * t];
+			sorted[dst + 1] = m_Triangles[3 * t + 1];
+			sorted[dst + 2] = m_Triangles[3 * t + 2];
+		}
+	}
+	for (unsigned int v = 0; v < m_VertexCount; v++)
+	{
+		for (unsigned int i = start[v] + 1; i < start[v + 1]; i++)
+		{
+			for (unsigned int j = i; j > start[v] && sorted[3 * j + 1] < sorted[3 * (j - 1) + 1]; j--)
+			{
+				std::swap(sorted[3 * j + 1], sorted[3 * (j - 1) + 1]);
+				std::swap(sorted[3 * j + 2], sorted[3 * (j - 1) + 2]);
+			}
+		}
+	}
+	m_Triangles.swap(sorted);
+
+	std::vector<unsigned int> out_start(m_VertexCount + 1, 0);
+	for (size_t e = 0; e < m_Triangles.size(); e++)
+		out_start[m_Triangles[e] + 1]++;
+	for (size_t v = 1; v < out_start.size(); v++)
+		out_start[v] += out_start[v - 1];
+	std::vector<unsigned int> out_edges(m_Triangles.size());
+	{
+		std::vector<unsigned int> cursor(out_start.begin(), out_start.end() - 1);
+		for (size_t e = 0; e < m_Triangles.size(); e++)
+			out_edges[cursor[m_Triangles[e]]++] = (unsigned int) e;
+	}
+
+	m_Halfedges.assign(m_Triangles.size(), INVALID_INDEX);
+	for (size_t e = 0; e < m_Triangles.size(); e++)
+	{
+		if (m_Halfedges[e] != INVALID_INDEX) continue;
+		unsigned int a = m_Triangles[e];
+		unsigned int b = m_Triangles[NextHalfedge((unsigned int) e)];
+		for (unsigned int k = out_start[b]; k < out_start[b + 1]; k++)
+		{
+			unsigned int f = out_edges[k];
+			if (m_Triangles[NextHalfedge(f)] == a)
+			{
+				Link((unsigned int) e, f);
+				break;
+			}
+		}
+	}
+}
+
+Triangulator::Location Triangulator::Locate(unsigned int p, unsigned int& r_edge)
+{
+	// Walk towards p, crossing any edge that has p on its outer side. Starting
+	// the edge checks at a random edge avoids cycling on degenerate input.
+	// Triangles are rewritten but never deleted, so any hint is a valid start.
+	unsigned int t = GetHint(p) / 3;
+	for (;;)
+	{
+		m_WalkState ^= m_WalkState << 13;
+		m_WalkState ^= m_WalkState >> 17;
+		m_WalkState ^= m_WalkState << 5;
+		unsigned int start = m_WalkState % 3;
+
+		unsigned int zero_edge = INVALID_INDEX;
+		int zero_count = 0;
+		bool moved = false;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			unsigned int e = 3 * t + (start + i) % 3;
+			double orientation = Orient(m_Triangles[e], m_Triangles[NextHalfedge(e)], p);
+			if (orientation < 0 && m_Halfedges[e] != INVALID_INDEX)
+			{
+				t = m_Halfedges[e] / 3;
+				moved = true;
+				break;
+			}
+			if (orientation == 0)
+			{
+				zero_edge = e;
+				zero_count++;
+			}
+		}
+		if (moved) continue;
+
+		if (zero_count == 0)
+		{
+			r_edge = 3 * t;
+			return Inside;
+		}
+		r_edge = zero_edge;
+		return zero_count == 1 ? OnEdge : OnVertex;
+	}
+}
+
+void Triangulator::SplitTriangle(unsigned int t, unsigned int p)
+{
+	// (v0, v1, v2) becomes (v0, v1, p), (v1, v2, p) and (v2, v0, p).
+	unsigned int e0 = 3 * t;
+	unsigned int v0 = m_Triangles[e0];
+	unsigned int v1 = m_Triangles[e0 + 1];
+	unsigned int v2 = m_Triangles[e0 + 2];
+	unsigned int h1 = m_Halfedges[e0 + 1];
+	unsigned int h2 = m_Halfedges[e0 + 2];
+
+	m_Triangles[e0 + 2] = p;
+	unsigned int e1 = AddTriangle(v1, v2, p);
+	unsigned int e2 = AddTriangle(v2, v0, p);
+
+	Link(e1, h1);
+	Link(e2, h2);
+	Link(e0 + 1, e1 + 2);
+	Link(e0 + 2, e2 + 1);
+	Link(e1 + 1, e2 + 2);
+
+	m_Last = e0;
+	Legalize(e0);
+	Legalize(e1);
+	Legalize(e2);
+}
+
+void Triangulator::SplitEdge(unsigned int e, unsigned int p)
+{
+	// p lies on the edge x->y shared by (x, y, z) and (y, x, w). Those become
+	// (z, x, p), (y, z, p), (w, y, p) and (x, w, p).
+	unsigned int b = m_Halfedges[e];
+	unsigned int x = m_Triangles[e];
+	unsigned int y = m_Triangles[NextHalfedge(e)];
+	unsigned int z = m_Triangles[PrevHalfedge(e)];
+	unsigned int h_yz = m_Halfedges[NextHalfedge(e)];
+	unsigned int h_zx = m_Halfedges[PrevHalfedge(e)];
+
+	unsigned int a0 = e - e % 3;
+	m_Triangles[a0] = z;
+	m_Triangles[a0 + 1] = x;
+	m_Triangles[a0 + 2] = p;
+	unsigned int a1 = AddTriangle(y, z, p);
+	Link(a0, h_zx);
+	Link(a1, h_yz);
+	Link(a0 + 2, a1 + 1);
+
+	m_Last = a0;
+	if (b == INVALID_INDEX)
+	{
+		m_Halfedges[a0 + 1] = INVALID_INDEX;
+		m_Halfedges[a1 + 2] = INVALID_INDEX;
+		Legalize(a0);
+		Legalize(a1);
+		return;
+	}
+
+	unsigned int w = m_Triangles[PrevHalfedge(b)];
+	unsigned int h_xw = m_Halfedges[NextHalfedge(b)];
+	unsigned int h_wy = m_Halfedges[PrevHalfedge(b)];
+
+	unsigned int b0 = b - b % 3;
+	m_Triangles[b0] = w;
+	m_Triangles[b0 + 1] = y;
+	m_Triangles[b0 + 2] = p;
+	unsigned int b1 = AddTriangle(x, w, p);
+	Link(b0, h_wy);
+	Link(b1, h_xw);
+	Link(b0 + 2, b1 + 1);
+
+	Link(a0 + 1, b1 + 2);
+	Link(a1 + 2, b0 + 1);
+
+	Legalize(a0);
+	Legalize(a1);
+	Legalize(b0);
+	Legalize(b1);
+}
+
+void Triangulator::Legalize(unsigned int a)
+{
+	// Every half-edge on the stack has the new point as its opposite vertex.
+	// If the point on the other side is inside the circumcircle the shared
+	// edge is flipped, and the two edges now facing the new point are checked.
+	m_Stack.push_back(a);
+	while (!m_Stack.empty())
+	{
+		a = m_Stack.back();
+		m_Stack.pop_back();
+
+		unsigned int b = m_Halfedges[a];
+		if (b == INVALID_INDEX) continue;
+
+		unsigned int al = NextHalfedge(a);
+		unsigned int ar = PrevHalfedge(a);
+		unsigned int bl = PrevHalfedge(b);
+		unsigned int br = NextHalfedge(b);
+
+		unsigned int p0 = m_Triangles[ar];
+		unsigned int pr = m_Triangles[a];
+		unsigned int pl = m_Triangles[al];
+		unsigned int p1 = m_Triangles[bl];
+
+		if (!InCircle(pr, pl, p0, p1)) continue;
+
+		m_Triangles[a] = p1;
+		m_Triangles[b] = p0;
+
+		unsigned int h_bl = m_Halfedges[bl];
+		unsigned int h_ar = m_Halfedges[ar];
+		Link(a, h_bl);
+		Link(b, h_ar);
+		Link(ar, bl);
+
+		m_Stack.push_back(a);
+		m_Stack.push_back(br);
+	}
+}
+
+unsigned int Triangulator::AddTriangle(unsigned int i0, unsigned int i1, unsigned int i2)
+{
+	unsigned int e = (unsigned int) m_Triangles.size();
+	m_Triangles.push_back(i0);
+	m_Triangles.push_back(i1);
+	m_Triangles.push_back(i2);
+	m_Halfedges.push_back(INVALID_INDEX);
+	m_Halfedges.push_back(INVALID_INDEX);
+	m_Halfedges.push_back(INVALID_INDEX);
+	return e;
+}
+
+void Triangulator::Link(unsigned int a, unsigned int b)
+{
+	m_Halfedges[a] = b;
+	if (b != INVALID_INDEX) m_Halfedges[b] = a;
+}
+
+double Triangulator::Orient(unsigned int a, unsigned int b, unsigned int c) const
+{
+	// Twice the signed area of (a, b, c), positive if counter-clockwise.
+	const double * pa = & m_Coords[2 * a];
+	const double * pb = & m_Coords[2 * b];
+	const double * pc = & m_Coords[2 * c];
+	return (pb[0] - pa[0]) * (pc[1] - pa[1]) - (pb[1] - pa[1]) * (pc[0] - pa[0]);
+}
+
+unsigned int Triangulator::Rank(unsigned int v) const
+{
+	if (v >= m_VertexCount) return UINT_MAX - 3 + (v - m_VertexCount);
+	return m_Ranks.empty() ? v : m_Ranks[v];
+}
+
+bool Triangulator::InCircle(unsigned int a, unsigned int b, unsigned int c, unsigned int d) const
+{
+	// True if d is inside the circumcircle of the counter-clockwise triangle (a, b, c).
+	const double * pd = & m_Coords[2 * d];
+	double adx = m_Coords[2 * a] - pd[0], ady = m_Coords[2 * a + 1] - pd[1];
+	double bdx = m_Coords[2 * b] - pd[0], bdy = m_Coords[2 * b + 1] - pd[1];
+	double cdx = m_Coords[2 * c] - pd[0], cdy = m_Coords[2 * c + 1] - pd[1];
+
+	double ad = adx * adx + ady * ady;
+	double bd = bdx * bdx + bdy * bdy;
+	double cd = cdx * cdx + cdy * cdy;
+
+	double det = ad * (bdx * cdy - cdx * bdy) + bd * (cdx * ady - adx * cdy) + cd * (adx * bdy - bdx * ady);
+	if (det != 0) return det > 0;
+
+	// Co-circular: lift every point by an infinitesimal amount, bigger for
+	// lower ranks, and take the sign of the first term that doesn't vanish.
+	// The derivative of the determinant for each lifted point is the
+	// orientation of the other three, with alternating signs.
+	unsigned int points[4] = { a, b, c, d };
+	std::sort(points, points + 4, [this](unsigned int i, unsigned int j) { return Rank(i) < Rank(j); });
+	for (unsigned int p : points)
+	{
+		double term;
+		if (p == a)			term = Orient(b, c, d);
+		else if (p == b)	term = -Orient(a, c, d);
+		else if (p == c)	term = Orient(a, b, d);
+		else				term = -Orient(a, b, c);
+		if (term != 0) return term > 0;
+	}
+	return false;
+}
+
+}
@@ -31,15 +31,20 @@ void MarkovChain::resetGenerator(const std::vector<std::string>& original_names,
 		processName(name);
 }
 
+void MarkovChain::setRandom(const Random& random)
+{
+	m_random = random;
+}
+
 std::string MarkovChain::getName()
  {
 	assert(m_chains.size() > 0);
 	std::string name;
 	do{
-		int n = rand() % v_samples.size();
+		int n = m_random.NextIndex((uint32_t) v_samples.size());
 		int name_length = v_samples[n].size();
 
-		int substring_start = v_samples[n].length() == order ? 0 : rand() % (v_samples[n].length() - order);
+		int substring_start = v_samples[n].length() == order ? 0 : m_random.NextIndex((uint32_t) (v_samples[n].length() - order));
 		
 		name = v_samples[n].substr(0, order);
 		if(name[0] == ' ')
@@ -51,7 +56,7 @@ std::string MarkovChain::getName()
 
 		while (name.length() < name_length) {
 			iterations++;
-			next_char = it->second[rand() % it->second.size()];
+			next_char = it->second[m_random.NextIndex((uint32_t) it->second.size())];
 
 			if(next_char != '\n'){
 				name.append(1, next_char);